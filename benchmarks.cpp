@@ -0,0 +1,346 @@
+﻿#include "benchmarks.h"
+#include "taskrepository.h"
+#include "taskjournal.h"
+#include "taskloader.h"
+#include "boardsnapshot.h"
+#include "reportbuilder.h"
+#include "taskmodel.h"
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QDebug>
+
+namespace {
+
+struct LoadResult
+{
+    int taskCount = 0;
+    qint64 firstBatchMs = -1;
+    qint64 totalMs = 0;
+    bool fromSnapshot = false;
+};
+
+// 在当前线程同步执行一次加载，记录首批和全部记录到达的时间
+LoadResult runLoader(const QString &databasePath, bool useSnapshot, QVector<TaskRecord> *records = nullptr)
+{
+    LoadResult result;
+    QElapsedTimer timer;
+    timer.start();
+    
+    TaskLoader loader(databasePath);
+    loader.setUseSnapshot(useSnapshot);
+    QObject::connect(&loader, &TaskLoader::recordsLoaded, [&](const QVector<TaskRecord> &batch) {
+        if (result.firstBatchMs < 0) {
+            result.firstBatchMs = timer.elapsed();
+        }
+        if (records) {
+            *records += batch;
+        }
+    });
+    QObject::connect(&loader, &TaskLoader::finished, [&](int taskCount, qint64, bool fromSnapshot) {
+        result.taskCount = taskCount;
+        result.fromSnapshot = fromSnapshot;
+    });
+    
+    loader.load();
+    result.totalMs = timer.elapsed();
+    return result;
+}
+
+} // namespace
+
+bool Benchmarks::createDatabase(const QString &path, int taskCount)
+{
+    TaskRepository repository("benchmark");
+    if (!repository.open(path, true)) {
+        return false;
+    }
+    
+    // 一次事务，按块通过仓库的批量接口写入带依赖的测试数据
+    repository.transaction();
+    const int chunkSize = 10000;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<TaskRecord> chunk;
+    chunk.reserve(chunkSize);
+    bool ok = true;
+    
+    for (int i = 0; ok && i < taskCount; ++i) {
+        TaskRecord record;
+        record.id = i + 1;
+        record.title = QString("Task %1").arg(i);
+        record.description = QString("Benchmark task number %1").arg(i);
+        record.status = i % 3;
+        record.priority = i % 3;
+        record.deadline = QDateTime::fromMSecsSinceEpoch(now + qint64(i % 90) * 24 * 3600 * 1000);
+        record.assignee = QString("user%1").arg(i % 50);
+        record.progress = (i * 7) % 101;
+        record.projectId = QString("project%1").arg(i % 20);
+        
+        // 每十个任务依赖前一个任务
+        if (i > 0 && i % 10 == 0) {
+            record.dependencyIds << TaskId(i);
+        }
+        
+        chunk.append(record);
+        if (chunk.size() == chunkSize || i == taskCount - 1) {
+            ok = repository.insertMany(chunk);
+            chunk.resize(0);
+        }
+    }
+    
+    ok = ok && repository.commit();
+    if (!ok) {
+        qDebug() << "Benchmark: insert failed:" << repository.database().lastError().text();
+        repository.rollback();
+    } else {
+        qDebug() << "Benchmark: inserted" << taskCount << "tasks,"
+                 << repository.databaseTimeNs() / 1000000 << "ms of database time";
+    }
+    repository.close();
+    return ok;
+}
+
+int Benchmarks::runStartup()
+{
+    QTextStream out(stdout);
+    const int sizes[] = { 10000, 100000, 1000000 };
+    
+    out << "tasks\tsql first\tsql total\tsnapshot write\tsnapshot first\tsnapshot total\n";
+    
+    for (int taskCount : sizes) {
+        QTemporaryDir dir;
+        if (!dir.isValid()) {
+            qDebug() << "Benchmark: cannot create temporary directory";
+            return 1;
+        }
+        
+        QString databasePath = dir.filePath("bench.db");
+        if (!createDatabase(databasePath, taskCount)) {
+            return 1;
+        }
+        
+        // SQL 路径：没有快照，逐行查询并解码
+        QVector<TaskRecord> records;
+        records.reserve(taskCount);
+        LoadResult sql = runLoader(databasePath, false, &records);
+        
+        // 用 SQL 读出的记录生成快照，序号取数据库当前的日志序号
+        QElapsedTimer writeTimer;
+        writeTimer.start();
+        qint64 changeCounter = 0;
+        {
+            TaskRepository repository("benchmark");
+            if (repository.open(databasePath)) {
+                QSqlDatabase db = repository.database();
+                changeCounter = TaskJournal::lastSequence(db);
+            }
+        }
+        BoardSnapshot::write(BoardSnapshot::pathForDatabase(databasePath), records, changeCounter);
+        qint64 writeMs = writeTimer.elapsed();
+        records.clear();
+        records.squeeze();
+        
+        LoadResult snapshot = runLoader(databasePath, true);
+        if (!snapshot.fromSnapshot || snapshot.taskCount != sql.taskCount) {
+            qDebug() << "Benchmark: snapshot load mismatch at" << taskCount << "tasks";
+        }
+        
+        out << taskCount << '\t'
+            << sql.firstBatchMs << " ms\t" << sql.totalMs << " ms\t"
+            << writeMs << " ms\t"
+            << snapshot.firstBatchMs << " ms\t" << snapshot.totalMs << " ms\n";
+        out.flush();
+    }
+    
+    return 0;
+}
+
+int Benchmarks::runSearch()
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qDebug() << "Benchmark: cannot create temporary directory";
+        return 1;
+    }
+    
+    QString databasePath = dir.filePath("bench.db");
+    if (!createDatabase(databasePath, 200000)) {
+        return 1;
+    }
+    
+    QTextStream out(stdout);
+    out << "query\tmatches\tlatency\n";
+    
+    TaskRepository repository("benchmark");
+    if (!repository.open(databasePath)) {
+        return 1;
+    }
+    
+    const char *queries[] = { "Task 19999", "benchmark", "number 123", "Task 1" };
+    for (const char *text : queries) {
+        QElapsedTimer timer;
+        timer.start();
+        QVector<TaskId> ids;
+        repository.search(QString::fromLatin1(text), ids, 5000);
+        out << text << '\t' << ids.size() << '\t' << timer.nsecsElapsed() / 1000 << " us\n";
+    }
+    out.flush();
+    
+    return 0;
+}
+
+int Benchmarks::runReport()
+{
+    QTextStream out(stdout);
+    const int sizes[] = { 100, 100000, 1000000 };
+    
+    out << "tasks\tinsert\treport\toverdue\n";
+    
+    for (int taskCount : sizes) {
+        QTemporaryDir dir;
+        if (!dir.isValid()) {
+            qDebug() << "Benchmark: cannot create temporary directory";
+            return 1;
+        }
+        
+        // 插入耗时包含维护汇总表的触发器
+        QString databasePath = dir.filePath("bench.db");
+        QElapsedTimer insertTimer;
+        insertTimer.start();
+        if (!createDatabase(databasePath, taskCount)) {
+            return 1;
+        }
+        qint64 insertMs = insertTimer.elapsed();
+        
+        TaskReport report;
+        ReportBuilder builder(databasePath);
+        QObject::connect(&builder, &ReportBuilder::finished, [&report](const TaskReport &result) {
+            report = result;
+        });
+        builder.build();
+        if (report.totalCount != taskCount) {
+            qDebug() << "Benchmark: report counted" << report.totalCount << "of" << taskCount << "tasks";
+        }
+        
+        out << taskCount << '\t' << insertMs << " ms\t" << report.elapsedMs << " ms\t" << report.overdueCount << '\n';
+        out.flush();
+    }
+    
+    return 0;
+}
+
+int Benchmarks::runSchedule()
+{
+    const int taskCount = 100000;
+    const int window = 1000;
+    const int changeCount = 1000;
+    QRandomGenerator random(42);
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    
+    // 每个任务依赖前 window 个任务中随机的 0~5 个，平均约 25 万条边，天然无环
+    QVector<TaskRecord> records;
+    records.reserve(taskCount);
+    for (int i = 0; i < taskCount; ++i) {
+        TaskRecord record;
+        record.id = i + 1;
+        record.title = QString("Task %1").arg(i);
+        record.progress = random.bounded(100);
+        if (random.bounded(10) == 0) {
+            record.deadline = QDateTime::fromSecsSinceEpoch(now + random.bounded(365) * 24 * 3600);
+        }
+        int dependencyCount = i > 0 ? random.bounded(6) : 0;
+        for (int k = 0; k < dependencyCount; ++k) {
+            TaskId depId = qMax(0, i - 1 - random.bounded(window)) + 1;
+            if (!record.dependencyIds.contains(depId)) {
+                record.dependencyIds << depId;
+            }
+        }
+        records.append(record);
+    }
+    
+    QTextStream out(stdout);
+    out << "operation\tcount\ttotal\tper op\trecomputed per op\n";
+    
+    TaskModel model;
+    QElapsedTimer timer;
+    timer.start();
+    model.insertLoaded(records);
+    model.finishLoading();
+    qint64 insertMs = timer.elapsed();
+    timer.restart();
+    model.schedule();
+    qint64 fullMs = timer.elapsed();
+    out << "load " << model.dependencyGraph().nodeCount() << " nodes, " << model.dependencyGraph().edgeCount()
+        << " edges\t1\t" << insertMs << " ms\t\t\n";
+    out << "full schedule\t1\t" << fullMs << " ms\t\t" << model.schedule().lastUpdateCount() << '\n';
+    
+    // 单个任务的修改：每次修改后立即取用排期，只重算受影响的子图
+    qint64 recomputed = 0;
+    timer.restart();
+    for (int i = 0; i < changeCount; ++i) {
+        model.setProgress(random.bounded(taskCount) + 1, random.bounded(101));
+        recomputed += model.schedule().lastUpdateCount();
+    }
+    qint64 progressNs = timer.nsecsElapsed();
+    out << "progress change\t" << changeCount << '\t' << progressNs / 1000000 << " ms\t"
+        << progressNs / changeCount / 1000 << " us\t" << recomputed / changeCount << '\n';
+    
+    recomputed = 0;
+    timer.restart();
+    for (int i = 0; i < changeCount; ++i) {
+        TaskRecord values;
+        values.deadline = QDateTime::fromSecsSinceEpoch(now + random.bounded(365) * 24 * 3600);
+        model.update(random.bounded(taskCount) + 1, values, TaskRecord::DirtyDeadline);
+        recomputed += model.schedule().lastUpdateCount();
+    }
+    qint64 deadlineNs = timer.nsecsElapsed();
+    out << "deadline change\t" << changeCount << '\t' << deadlineNs / 1000000 << " ms\t"
+        << deadlineNs / changeCount / 1000 << " us\t" << recomputed / changeCount << '\n';
+    
+    // 新增依赖包括环检测；一半指向更早的任务（不会成环），一半指向更晚的任务（成环时被拒绝）
+    recomputed = 0;
+    int rejected = 0;
+    timer.restart();
+    for (int i = 0; i < changeCount; ++i) {
+        int task = window + random.bounded(taskCount - 2 * window);
+        int offset = 1 + random.bounded(window);
+        TaskId dependencyId = (i % 2 == 0 ? task - offset : task + offset) + 1;
+        if (!model.addDependency(task + 1, dependencyId)) {
+            ++rejected;
+        }
+        recomputed += model.schedule().lastUpdateCount();
+    }
+    qint64 edgeNs = timer.nsecsElapsed();
+    out << "dependency add (" << rejected << " rejected)\t" << changeCount << '\t' << edgeNs / 1000000 << " ms\t"
+        << edgeNs / changeCount / 1000 << " us\t" << recomputed / changeCount << '\n';
+    
+    // 悬停高亮的上下游闭包：第一次遍历图，之后命中缓存
+    const DependencyGraph &graph = model.dependencyGraph();
+    const int hoverCount = 100;
+    QVector<TaskId> hovered;
+    for (int i = 0; i < hoverCount; ++i) {
+        hovered << random.bounded(taskCount) + 1;
+    }
+    qint64 chainSize = 0;
+    timer.restart();
+    for (TaskId id : hovered) {
+        chainSize += graph.upstreamTasks(id).size() + graph.blockedTasks(id).size();
+    }
+    qint64 coldNs = timer.nsecsElapsed();
+    timer.restart();
+    for (TaskId id : hovered) {
+        graph.upstreamTasks(id);
+        graph.blockedTasks(id);
+    }
+    qint64 warmNs = timer.nsecsElapsed();
+    out << "chain query (cold, " << chainSize / hoverCount << " tasks per chain)\t" << hoverCount << '\t'
+        << coldNs / 1000000 << " ms\t" << coldNs / hoverCount / 1000 << " us\t\n";
+    out << "chain query (cached)\t" << hoverCount << '\t' << warmNs / 1000000 << " ms\t"
+        << warmNs / hoverCount / 1000 << " us\t\n";
+    out.flush();
+    
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QString>
+
+// 命令行基准测试，不启动界面，结果输出到标准输出
+// 用法：QtConsoleApplication1 --bench-startup | --bench-search | --bench-report | --bench-schedule
+class Benchmarks
+{
+public:
+    // 分别在 1万/10万/100万 任务规模下比较 SQL 加载与快照加载的耗时
+    static int runStartup();
+
+    // 在 20 万任务的数据库上测量全文搜索延迟
+    static int runSearch();
+
+    // 分别在 100/10万/100万 任务规模下测量生成报表的耗时，以及汇总表带来的写入开销
+    static int runReport();
+
+    // 在 10万节点的随机依赖图上测量完整排期、单个任务修改后的增量重算和依赖链查询
+    static int runSchedule();
+
+private:
+    static bool createDatabase(const QString &path, int taskCount);
+};
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,236 @@
+﻿#include "boardsnapshot.h"
+#include <QSaveFile>
+#include <QHash>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'T', 'M', 'S', 'N', 'A', 'P', '0', '1' };
+const quint32 SNAPSHOT_VERSION = 3;     // v2: 只保存描述预览；v3: 整数任务ID
+const qint64 NO_DEADLINE = std::numeric_limits<qint64>::min();
+
+} // namespace
+
+struct BoardSnapshot::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 recordCount;
+    quint32 edgeCount;
+    quint32 reserved;
+    qint64 changeCounter;
+    quint64 recordsOffset;
+    quint64 edgesOffset;
+    quint64 stringsOffset;
+    quint64 stringsLength;      // 以 QChar 计
+};
+
+// 字符串以 UTF-16 存放在字符串表中，偏移和长度都以 QChar 计
+struct BoardSnapshot::Record
+{
+    qint64 deadline;
+    qint64 id;
+    quint32 titleOffset, titleLength;
+    quint32 previewOffset, previewLength;
+    quint32 assigneeOffset, assigneeLength;
+    quint32 projectOffset, projectLength;
+    quint32 edgeBegin, edgeCount;   // 依赖边在边表中的范围，边存的是记录下标
+    qint8 status, priority, progress, reserved;
+    quint32 padding;
+};
+
+BoardSnapshot::BoardSnapshot(const QString &path)
+    : m_file(path),
+      m_data(nullptr),
+      m_size(0),
+      m_header(nullptr),
+      m_records(nullptr),
+      m_edges(nullptr),
+      m_strings(nullptr)
+{
+}
+
+BoardSnapshot::~BoardSnapshot()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+QString BoardSnapshot::pathForDatabase(const QString &databasePath)
+{
+    return databasePath + ".snapshot";
+}
+
+bool BoardSnapshot::write(const QString &path, const QVector<TaskRecord> &records, qint64 changeCounter)
+{
+    static_assert(sizeof(Header) == 64, "snapshot header layout changed");
+    static_assert(sizeof(Record) == 64, "snapshot record layout changed");
+    
+    QHash<TaskId, quint32> indexById;
+    indexById.reserve(records.size());
+    for (int i = 0; i < records.size(); ++i) {
+        indexById.insert(records.at(i).id, quint32(i));
+    }
+    
+    QVector<Record> entries;
+    entries.reserve(records.size());
+    QVector<quint32> edges;
+    QVector<QChar> strings;
+    
+    auto addString = [&strings](const QString &text, quint32 &offset, quint32 &length) {
+        offset = quint32(strings.size());
+        length = quint32(text.size());
+        strings.resize(strings.size() + text.size());
+        std::copy(text.constData(), text.constData() + text.size(), strings.data() + offset);
+    };
+    
+    for (const TaskRecord &record : records) {
+        Record entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.deadline = record.deadline.isValid() ? record.deadline.toMSecsSinceEpoch() : NO_DEADLINE;
+        entry.id = record.id;
+        addString(record.title, entry.titleOffset, entry.titleLength);
+        addString(record.descriptionPreview, entry.previewOffset, entry.previewLength);
+        addString(record.assignee, entry.assigneeOffset, entry.assigneeLength);
+        addString(record.projectId, entry.projectOffset, entry.projectLength);
+        entry.status = qint8(record.status);
+        entry.priority = qint8(record.priority);
+        entry.progress = qint8(record.progress);
+        
+        entry.edgeBegin = quint32(edges.size());
+        for (TaskId depId : record.dependencyIds) {
+            auto it = indexById.constFind(depId);
+            if (it != indexById.constEnd()) {
+                edges.append(it.value());
+            }
+        }
+        entry.edgeCount = quint32(edges.size()) - entry.edgeBegin;
+        entries.append(entry);
+    }
+    
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.recordCount = quint32(entries.size());
+    header.edgeCount = quint32(edges.size());
+    header.changeCounter = changeCounter;
+    header.recordsOffset = sizeof(Header);
+    header.edgesOffset = header.recordsOffset + quint64(entries.size()) * sizeof(Record);
+    header.stringsOffset = header.edgesOffset + quint64(edges.size()) * sizeof(quint32);
+    // 字符串表按 QChar 对齐
+    header.stringsOffset = (header.stringsOffset + 1) & ~quint64(1);
+    header.stringsLength = quint64(strings.size());
+    
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Snapshot: cannot write" << path << file.errorString();
+        return false;
+    }
+    
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.constData()), entries.size() * qint64(sizeof(Record)));
+    file.write(reinterpret_cast<const char*>(edges.constData()), edges.size() * qint64(sizeof(quint32)));
+    if (file.pos() < qint64(header.stringsOffset)) {
+        file.write(QByteArray(int(header.stringsOffset - file.pos()), '\0'));
+    }
+    file.write(reinterpret_cast<const char*>(strings.constData()), strings.size() * qint64(sizeof(QChar)));
+    
+    return file.commit();
+}
+
+bool BoardSnapshot::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(Header))) {
+        return false;
+    }
+    
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        qDebug() << "Snapshot: cannot map" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+    
+    m_header = reinterpret_cast<const Header*>(m_data);
+    if (std::memcmp(m_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || m_header->version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    
+    // 校验各段都落在文件范围内，损坏的快照直接放弃
+    quint64 size = quint64(m_size);
+    if (m_header->recordsOffset + quint64(m_header->recordCount) * sizeof(Record) > m_header->edgesOffset
+        || m_header->edgesOffset + quint64(m_header->edgeCount) * sizeof(quint32) > m_header->stringsOffset
+        || m_header->stringsOffset + m_header->stringsLength * sizeof(QChar) > size) {
+        qDebug() << "Snapshot: corrupt file" << m_file.fileName();
+        return false;
+    }
+    
+    m_records = reinterpret_cast<const Record*>(m_data + m_header->recordsOffset);
+    m_edges = reinterpret_cast<const quint32*>(m_data + m_header->edgesOffset);
+    m_strings = reinterpret_cast<const QChar*>(m_data + m_header->stringsOffset);
+    return true;
+}
+
+qint64 BoardSnapshot::changeCounter() const
+{
+    return m_header ? m_header->changeCounter : -1;
+}
+
+int BoardSnapshot::recordCount() const
+{
+    return m_header ? int(m_header->recordCount) : 0;
+}
+
+int BoardSnapshot::status(int index) const
+{
+    return m_records[index].status;
+}
+
+QString BoardSnapshot::string(quint32 offset, quint32 length) const
+{
+    if (quint64(offset) + length > m_header->stringsLength) {
+        return QString();
+    }
+    return QString(m_strings + offset, int(length));
+}
+
+TaskRecord BoardSnapshot::record(int index) const
+{
+    const Record &entry = m_records[index];
+    
+    TaskRecord record;
+    record.id = entry.id;
+    record.title = string(entry.titleOffset, entry.titleLength);
+    record.descriptionPreview = string(entry.previewOffset, entry.previewLength);
+    record.descriptionLoaded = false;
+    record.assignee = string(entry.assigneeOffset, entry.assigneeLength);
+    record.projectId = string(entry.projectOffset, entry.projectLength);
+    record.status = entry.status;
+    record.priority = entry.priority;
+    record.progress = entry.progress;
+    if (entry.deadline != NO_DEADLINE) {
+        record.deadline = QDateTime::fromMSecsSinceEpoch(entry.deadline);
+    }
+    
+    if (quint64(entry.edgeBegin) + entry.edgeCount <= m_header->edgeCount) {
+        record.dependencyIds.reserve(int(entry.edgeCount));
+        for (quint32 i = 0; i < entry.edgeCount; ++i) {
+            quint32 target = m_edges[entry.edgeBegin + i];
+            if (target < m_header->recordCount) {
+                record.dependencyIds.append(m_records[target].id);
+            }
+        }
+    }
+    
+    return record;
+}
@@ -0,0 +1,46 @@
+#ifndef BOARDSNAPSHOT_H
+#define BOARDSNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "taskrecord.h"
+
+// 看板的二进制快照：定长记录 + 字符串表 + 依赖边表（描述只保存预览）
+// 启动时通过内存映射直接读取，变更计数与数据库不一致时视为过期
+// 快照只是本机缓存，使用本机字节序
+class BoardSnapshot
+{
+public:
+    explicit BoardSnapshot(const QString &path);
+    ~BoardSnapshot();
+
+    static QString pathForDatabase(const QString &databasePath);
+
+    // 写入快照（先写临时文件再原子替换）
+    static bool write(const QString &path, const QVector<TaskRecord> &records, qint64 changeCounter);
+
+    // 映射并校验快照文件
+    bool open();
+
+    qint64 changeCounter() const;
+    int recordCount() const;
+    int status(int index) const;
+    TaskRecord record(int index) const;
+
+private:
+    struct Header;
+    struct Record;
+
+    QString string(quint32 offset, quint32 length) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    const Header *m_header;
+    const Record *m_records;
+    const quint32 *m_edges;
+    const QChar *m_strings;
+};
+
+#endif // BOARDSNAPSHOT_H
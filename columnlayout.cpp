@@ -0,0 +1,138 @@
+﻿#include "columnlayout.h"
+#include "taskcard.h"
+
+ColumnLayout::ColumnLayout()
+    : m_x(0),
+      m_spacing(0)
+{
+    m_tops.append(0);
+}
+
+void ColumnLayout::setGeometry(qreal x, qreal top, qreal spacing)
+{
+    m_x = x;
+    m_spacing = spacing;
+    m_tops[0] = top;
+    relayout(0);
+}
+
+int ColumnLayout::indexAt(qreal y) const
+{
+    // 中线 (m_tops[i] + m_tops[i + 1]) / 2 随 i 单调不减
+    int low = 0;
+    int high = m_cards.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if ((m_tops.at(mid) + m_tops.at(mid + 1)) / 2 <= y) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void ColumnLayout::append(TaskCard *card)
+{
+    insert(m_cards.size(), card);
+}
+
+void ColumnLayout::insert(int index, TaskCard *card)
+{
+    index = qBound(0, index, m_cards.size());
+    m_cards.insert(index, card);
+    m_tops.insert(index, m_tops.at(index));
+    relayout(index);
+}
+
+void ColumnLayout::remove(TaskCard *card)
+{
+    int index = m_index.value(card, -1);
+    if (index < 0) {
+        return;
+    }
+    m_index.remove(card);
+    m_cards.remove(index);
+    m_tops.remove(index);
+    relayout(index);
+}
+
+void ColumnLayout::appendMany(const QVector<TaskCard*> &cards)
+{
+    if (cards.isEmpty()) {
+        return;
+    }
+    int from = m_cards.size();
+    m_cards += cards;
+    m_tops.resize(m_cards.size() + 1);
+    relayout(from);
+}
+
+void ColumnLayout::removeMany(const QSet<TaskCard*> &cards)
+{
+    int first = m_cards.size();
+    int kept = 0;
+    for (int i = 0; i < m_cards.size(); ++i) {
+        TaskCard *card = m_cards.at(i);
+        if (cards.contains(card)) {
+            m_index.remove(card);
+            first = qMin(first, i);
+            continue;
+        }
+        m_cards[kept++] = card;
+    }
+    if (kept == m_cards.size()) {
+        return;
+    }
+    // m_tops[first] 仍是第一张被删卡片的顶部，正好是重排的起点
+    m_cards.resize(kept);
+    m_tops.resize(kept + 1);
+    relayout(first);
+}
+
+void ColumnLayout::move(TaskCard *card, int index)
+{
+    int from = indexOf(card);
+    if (from < 0) {
+        return;
+    }
+    int to = qBound(0, index > from ? index - 1 : index, m_cards.size() - 1);
+    if (to == from) {
+        // 位置不变，只把拖走的卡片放回原处
+        relayout(from);
+        return;
+    }
+    
+    m_cards.remove(from);
+    m_cards.insert(to, card);
+    relayout(qMin(from, to));
+}
+
+void ColumnLayout::reset(const QVector<TaskCard*> &cards)
+{
+    m_cards = cards;
+    m_tops.resize(m_cards.size() + 1);
+    m_index.clear();
+    relayout(0);
+}
+
+void ColumnLayout::clear()
+{
+    reset(QVector<TaskCard*>());
+}
+
+void ColumnLayout::relayout(int from)
+{
+    from = qBound(0, from, m_cards.size());
+    qreal y = m_tops.at(from);
+    for (int i = from; i < m_cards.size(); ++i) {
+        TaskCard *card = m_cards.at(i);
+        m_tops[i] = y;
+        m_index.insert(card, i);
+        if (card->isVisible()) {
+            card->setPos(m_x, y);
+            y += card->boundingRect().height() + m_spacing;
+        }
+    }
+    m_tops[m_cards.size()] = y;
+}
@@ -0,0 +1,52 @@
+#ifndef COLUMNLAYOUT_H
+#define COLUMNLAYOUT_H
+
+#include <QVector>
+#include <QHash>
+#include <QSet>
+
+class TaskCard;
+
+// 一个状态列的卡片顺序和累计纵坐标：m_tops[i] 是第 i 张卡片的顶部，最后一项是列底
+// 隐藏的卡片保留位置但高度为 0，筛选前后顺序不变
+// 插入、删除、移动和显隐变化只重新摆放变化点之后的卡片，不排序也不触碰前面的卡片
+class ColumnLayout
+{
+public:
+    ColumnLayout();
+
+    void setGeometry(qreal x, qreal top, qreal spacing);
+
+    int size() const { return m_cards.size(); }
+    TaskCard *at(int index) const { return m_cards.at(index); }
+    bool contains(const TaskCard *card) const { return m_index.contains(card); }
+    int indexOf(const TaskCard *card) const { return m_index.value(card, -1); }
+    const QVector<TaskCard*> &cards() const { return m_cards; }
+
+    // 在纵坐标 y 处放下卡片时的插入位置（第一张中线低于 y 的卡片之前），二分查找
+    int indexAt(qreal y) const;
+
+    void append(TaskCard *card);
+    void insert(int index, TaskCard *card);
+    void remove(TaskCard *card);
+    // 批量追加和删除（多选操作）：一次压缩数组，只从第一个变化点重排一遍
+    void appendMany(const QVector<TaskCard*> &cards);
+    void removeMany(const QSet<TaskCard*> &cards);
+    // 列内移动，index 是移动前列表中的插入位置（indexAt 的结果）
+    void move(TaskCard *card, int index);
+    // 整列换成新的顺序（搜索按相关度排序时）
+    void reset(const QVector<TaskCard*> &cards);
+    void clear();
+
+    // 从 index 开始重新摆放，卡片高度或显隐变化后由调用方指定变化点
+    void relayout(int from);
+
+private:
+    qreal m_x;
+    qreal m_spacing;
+    QVector<TaskCard*> m_cards;
+    QVector<qreal> m_tops;
+    QHash<const TaskCard*, int> m_index;
+};
+
+#endif // COLUMNLAYOUT_H
@@ -0,0 +1,503 @@
+﻿#include "dependencygraph.h"
+#include <algorithm>
+
+DependencyGraph::DependencyGraph()
+    : m_edgeCount(0),
+      m_epoch(0),
+      m_nextOrder(0),
+      m_orderStale(false),
+      m_acyclic(true),
+      m_upstreamClosures(CLOSURE_CACHE_SIZE),
+      m_downstreamClosures(CLOSURE_CACHE_SIZE)
+{
+}
+
+void DependencyGraph::clear()
+{
+    m_ids.clear();
+    m_nodes.clear();
+    m_forward.clear();
+    m_reverse.clear();
+    m_marks.clear();
+    m_order.clear();
+    m_upstreamClosures.clear();
+    m_downstreamClosures.clear();
+    m_edgeCount = 0;
+    m_nextOrder = 0;
+    m_orderStale = false;
+    m_acyclic = true;
+}
+
+int DependencyGraph::nodeOf(TaskId id)
+{
+    int node = find(id);
+    if (node >= 0) {
+        return node;
+    }
+    node = m_ids.size();
+    m_nodes.insert(id, node);
+    m_ids.append(id);
+    m_forward.append(QVector<int>());
+    m_reverse.append(QVector<int>());
+    m_marks.append(0);
+    // 新节点还没有边，排在最后总是合法的
+    m_order.append(m_nextOrder++);
+    return node;
+}
+
+void DependencyGraph::setDependencies(TaskId id, const QVector<TaskId> &dependencyIds)
+{
+    int node = nodeOf(id);
+    for (int dep : m_forward.at(node)) {
+        m_reverse[dep].removeOne(node);
+        invalidateClosures(node, dep);
+    }
+    m_edgeCount -= m_forward.at(node).size();
+    if (!m_acyclic && !m_forward.at(node).isEmpty()) {
+        m_orderStale = true;
+    }
+    m_forward[node].clear();
+    
+    for (TaskId depId : dependencyIds) {
+        int dep = find(depId);
+        if (dep < 0 || dep == node || m_forward.at(node).contains(dep)) {
+            continue;
+        }
+        m_forward[node].append(dep);
+        m_reverse[dep].append(node);
+        ++m_edgeCount;
+        markOrderStale(node, dep);
+        invalidateClosures(node, dep);
+    }
+}
+
+bool DependencyGraph::addEdge(TaskId id, TaskId dependencyId)
+{
+    int node = find(id);
+    int dep = find(dependencyId);
+    if (node < 0 || dep < 0 || node == dep) {
+        return false;
+    }
+    if (m_forward.at(node).contains(dep)) {
+        return true;
+    }
+    
+    ensureOrder();
+    if (!m_acyclic) {
+        // 旧数据中已有环，序号不可靠，退回完整搜索
+        if (reach(dep, node, false, nullptr)) {
+            return false;
+        }
+        m_orderStale = true;
+    } else if (m_order.at(dep) > m_order.at(node) && !reorder(node, dep)) {
+        return false;
+    }
+    
+    m_forward[node].append(dep);
+    m_reverse[dep].append(node);
+    ++m_edgeCount;
+    invalidateClosures(node, dep);
+    return true;
+}
+
+void DependencyGraph::removeEdge(TaskId id, TaskId dependencyId)
+{
+    int node = find(id);
+    int dep = find(dependencyId);
+    if (node < 0 || dep < 0) {
+        return;
+    }
+    if (m_forward[node].removeOne(dep)) {
+        m_reverse[dep].removeOne(node);
+        --m_edgeCount;
+        invalidateClosures(node, dep);
+        // 删边不会破坏已有顺序；原来有环时可能因此变得无环
+        if (!m_acyclic) {
+            m_orderStale = true;
+        }
+    }
+}
+
+bool DependencyGraph::wouldCreateCycle(TaskId id, TaskId dependencyId) const
+{
+    if (id == dependencyId) {
+        return true;
+    }
+    int node = find(id);
+    int dep = find(dependencyId);
+    if (node < 0 || dep < 0) {
+        // 新节点还没有任何边，不可能成环
+        return false;
+    }
+    ensureOrder();
+    if (m_acyclic && m_order.at(dep) < m_order.at(node)) {
+        // dep 的所有上游序号都比它小，不可能到达 node
+        return false;
+    }
+    return reach(dep, node, false, nullptr);
+}
+
+void DependencyGraph::removeNode(TaskId id)
+{
+    int node = find(id);
+    if (node < 0) {
+        return;
+    }
+    int last = m_ids.size() - 1;
+    
+    // 包含被删节点的闭包作废，其余闭包把末尾节点的位移到它的新下标
+    QCache<TaskId, Closure> *caches[] = { &m_upstreamClosures, &m_downstreamClosures };
+    for (QCache<TaskId, Closure> *cache : caches) {
+        const QList<TaskId> keys = cache->keys();
+        for (TaskId key : keys) {
+            Closure *closure = cache->object(key);
+            if (key == id || closure->contains(node)) {
+                cache->remove(key);
+            } else if (node != last && closure->contains(last)) {
+                closure->members.clearBit(last);
+                closure->members.setBit(node);
+            }
+        }
+    }
+    
+    for (int dep : m_forward.at(node)) {
+        m_reverse[dep].removeOne(node);
+    }
+    for (int user : m_reverse.at(node)) {
+        m_forward[user].removeOne(node);
+    }
+    m_edgeCount -= m_forward.at(node).size() + m_reverse.at(node).size();
+    
+    // 末尾的节点移到空位，只需改写它的邻居中指向它的下标
+    if (node != last) {
+        for (int dep : m_forward.at(last)) {
+            QVector<int> &users = m_reverse[dep];
+            users[users.indexOf(last)] = node;
+        }
+        for (int user : m_reverse.at(last)) {
+            QVector<int> &deps = m_forward[user];
+            deps[deps.indexOf(last)] = node;
+        }
+        m_ids[node] = m_ids.at(last);
+        m_forward[node] = m_forward.at(last);
+        m_reverse[node] = m_reverse.at(last);
+        m_order[node] = m_order.at(last);
+        m_nodes.insert(m_ids.at(node), node);
+    }
+    m_nodes.remove(id);
+    m_ids.removeLast();
+    m_forward.removeLast();
+    m_reverse.removeLast();
+    m_marks.removeLast();
+    m_order.removeLast();
+    if (!m_acyclic) {
+        m_orderStale = true;
+    }
+}
+
+QVector<TaskId> DependencyGraph::dependencies(TaskId id) const
+{
+    QVector<TaskId> ids;
+    int node = find(id);
+    if (node >= 0) {
+        ids.reserve(m_forward.at(node).size());
+        for (int dep : m_forward.at(node)) {
+            ids.append(m_ids.at(dep));
+        }
+    }
+    return ids;
+}
+
+QVector<TaskId> DependencyGraph::dependents(TaskId id) const
+{
+    QVector<TaskId> ids;
+    int node = find(id);
+    if (node >= 0) {
+        ids.reserve(m_reverse.at(node).size());
+        for (int user : m_reverse.at(node)) {
+            ids.append(m_ids.at(user));
+        }
+    }
+    return ids;
+}
+
+QVector<TaskId> DependencyGraph::blockedTasks(TaskId id) const
+{
+    int node = find(id);
+    return node >= 0 ? closure(node, true)->ids : QVector<TaskId>();
+}
+
+QVector<TaskId> DependencyGraph::upstreamTasks(TaskId id) const
+{
+    int node = find(id);
+    return node >= 0 ? closure(node, false)->ids : QVector<TaskId>();
+}
+
+bool DependencyGraph::dependsOn(TaskId id, TaskId other) const
+{
+    int node = find(id);
+    int otherNode = find(other);
+    if (node < 0 || otherNode < 0 || node == otherNode) {
+        return false;
+    }
+    return closure(node, false)->contains(otherNode);
+}
+
+const DependencyGraph::Closure *DependencyGraph::closure(int node, bool downstream) const
+{
+    QCache<TaskId, Closure> &cache = downstream ? m_downstreamClosures : m_upstreamClosures;
+    TaskId id = m_ids.at(node);
+    if (Closure *cached = cache.object(id)) {
+        return cached;
+    }
+    
+    QVector<int> visited;
+    reach(node, -1, downstream, &visited);
+    Closure *result = new Closure;
+    result->members.resize(m_ids.size());
+    result->ids.reserve(visited.size());
+    for (int other : visited) {
+        if (other != node) {
+            result->members.setBit(other);
+            result->ids.append(m_ids.at(other));
+        }
+    }
+    cache.insert(id, result);
+    return result;
+}
+
+void DependencyGraph::invalidateClosures(int node, int dep)
+{
+    if (m_upstreamClosures.isEmpty() && m_downstreamClosures.isEmpty()) {
+        return;
+    }
+    // node 的上游多了（或少了）dep 的上游，所有依赖 node 的任务同样受影响；下游方向对称
+    TaskId nodeId = m_ids.at(node);
+    const QList<TaskId> upstreamKeys = m_upstreamClosures.keys();
+    for (TaskId key : upstreamKeys) {
+        if (key == nodeId || m_upstreamClosures.object(key)->contains(node)) {
+            m_upstreamClosures.remove(key);
+        }
+    }
+    TaskId depId = m_ids.at(dep);
+    const QList<TaskId> downstreamKeys = m_downstreamClosures.keys();
+    for (TaskId key : downstreamKeys) {
+        if (key == depId || m_downstreamClosures.object(key)->contains(dep)) {
+            m_downstreamClosures.remove(key);
+        }
+    }
+}
+
+QVector<QPair<TaskId, TaskId>> DependencyGraph::cycleEdges() const
+{
+    QVector<QPair<TaskId, TaskId>> edges;
+    ensureOrder();
+    if (m_acyclic) {
+        return edges;
+    }
+    
+    // 深度优先遍历中指向仍在栈上的节点的边（回边）构成所有环的一个边割集，去掉它们后剩下的边无环
+    // 状态：0 未访问，1 在栈上，2 已完成
+    int count = m_ids.size();
+    QVector<char> state(count, 0);
+    QVector<QPair<int, int>> stack;     // (节点, 下一条要看的边)
+    for (int root = 0; root < count; ++root) {
+        if (state.at(root) != 0) {
+            continue;
+        }
+        state[root] = 1;
+        stack.append(qMakePair(root, 0));
+        while (!stack.isEmpty()) {
+            QPair<int, int> &top = stack.last();
+            int node = top.first;
+            const QVector<int> &deps = m_forward.at(node);
+            if (top.second == deps.size()) {
+                state[node] = 2;
+                stack.removeLast();
+                continue;
+            }
+            int dep = deps.at(top.second++);
+            if (state.at(dep) == 1) {
+                edges.append(qMakePair(m_ids.at(node), m_ids.at(dep)));
+            } else if (state.at(dep) == 0) {
+                state[dep] = 1;
+                stack.append(qMakePair(dep, 0));
+            }
+        }
+    }
+    return edges;
+}
+
+bool DependencyGraph::topologicalOrder(QVector<TaskId> &order) const
+{
+    QVector<int> nodes;
+    bool acyclic = topologicalNodes(nodes);
+    order.clear();
+    order.reserve(nodes.size());
+    for (int node : nodes) {
+        order.append(m_ids.at(node));
+    }
+    return acyclic;
+}
+
+bool DependencyGraph::topologicalNodes(QVector<int> &order) const
+{
+    // Kahn 算法：剩余依赖数为 0 的节点先输出，输出后减少依赖它的节点的计数
+    int count = m_ids.size();
+    QVector<int> remaining(count);
+    order.clear();
+    order.reserve(count);
+    for (int node = 0; node < count; ++node) {
+        remaining[node] = m_forward.at(node).size();
+        if (remaining.at(node) == 0) {
+            order.append(node);
+        }
+    }
+    
+    // 输出序列本身就是队列
+    for (int head = 0; head < order.size(); ++head) {
+        for (int user : m_reverse.at(order.at(head))) {
+            if (--remaining[user] == 0) {
+                order.append(user);
+            }
+        }
+    }
+    if (order.size() == count) {
+        return true;
+    }
+    
+    for (int node = 0; node < count; ++node) {
+        if (remaining.at(node) > 0) {
+            order.append(node);
+        }
+    }
+    return false;
+}
+
+bool DependencyGraph::reach(int start, int target, bool reverse, QVector<int> *visited) const
+{
+    const QVector<QVector<int>> &edges = reverse ? m_reverse : m_forward;
+    quint32 epoch = nextEpoch();
+    QVector<int> stack;
+    stack.append(start);
+    m_marks[start] = epoch;
+    
+    while (!stack.isEmpty()) {
+        int node = stack.takeLast();
+        if (node == target) {
+            return true;
+        }
+        if (visited) {
+            visited->append(node);
+        }
+        for (int next : edges.at(node)) {
+            if (m_marks.at(next) != epoch) {
+                m_marks[next] = epoch;
+                stack.append(next);
+            }
+        }
+    }
+    return false;
+}
+
+int DependencyGraph::orderOf(int node) const
+{
+    ensureOrder();
+    return m_order.at(node);
+}
+
+bool DependencyGraph::reorder(int node, int dep)
+{
+    // 需要 dep 排在 node 之前，目前 order(node) < order(dep)
+    // 受影响的只有序号在两者之间的节点：node 的下游中序号不超过 dep 的，和 dep 的上游中序号不小于 node 的
+    int lower = m_order.at(node);
+    int upper = m_order.at(dep);
+    
+    QVector<int> downstream;
+    quint32 epoch = nextEpoch();
+    QVector<int> stack;
+    stack.append(node);
+    m_marks[node] = epoch;
+    while (!stack.isEmpty()) {
+        int current = stack.takeLast();
+        downstream.append(current);
+        for (int user : m_reverse.at(current)) {
+            if (user == dep) {
+                return false;
+            }
+            if (m_marks.at(user) != epoch && m_order.at(user) < upper) {
+                m_marks[user] = epoch;
+                stack.append(user);
+            }
+        }
+    }
+    
+    QVector<int> upstream;
+    epoch = nextEpoch();
+    stack.append(dep);
+    m_marks[dep] = epoch;
+    while (!stack.isEmpty()) {
+        int current = stack.takeLast();
+        upstream.append(current);
+        for (int prior : m_forward.at(current)) {
+            if (m_marks.at(prior) != epoch && m_order.at(prior) > lower) {
+                m_marks[prior] = epoch;
+                stack.append(prior);
+            }
+        }
+    }
+    
+    // 两组节点各自保持原有的相对顺序，共用原来的序号集合：上游整体排到下游之前
+    auto byOrder = [this](int a, int b) { return m_order.at(a) < m_order.at(b); };
+    std::sort(downstream.begin(), downstream.end(), byOrder);
+    std::sort(upstream.begin(), upstream.end(), byOrder);
+    QVector<int> slots;
+    slots.reserve(downstream.size() + upstream.size());
+    for (int current : upstream) {
+        slots.append(m_order.at(current));
+    }
+    for (int current : downstream) {
+        slots.append(m_order.at(current));
+    }
+    std::sort(slots.begin(), slots.end());
+    
+    int next = 0;
+    for (int current : upstream) {
+        m_order[current] = slots.at(next++);
+    }
+    for (int current : downstream) {
+        m_order[current] = slots.at(next++);
+    }
+    return true;
+}
+
+void DependencyGraph::ensureOrder() const
+{
+    if (!m_orderStale) {
+        return;
+    }
+    QVector<int> nodes;
+    m_acyclic = topologicalNodes(nodes);
+    for (int i = 0; i < nodes.size(); ++i) {
+        m_order[nodes.at(i)] = i;
+    }
+    m_nextOrder = nodes.size();
+    m_orderStale = false;
+}
+
+void DependencyGraph::markOrderStale(int node, int dep)
+{
+    if (m_order.at(dep) > m_order.at(node)) {
+        m_orderStale = true;
+    }
+}
+
+quint32 DependencyGraph::nextEpoch() const
+{
+    if (++m_epoch == 0) {
+        // 轮次回绕时清零一次，避免与旧标记混淆
+        m_marks.fill(0);
+        m_epoch = 1;
+    }
+    return m_epoch;
+}
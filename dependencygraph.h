@@ -0,0 +1,108 @@
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QVector>
+#include <QHash>
+#include <QCache>
+#include <QBitArray>
+#include <QPair>
+#include "taskrecord.h"
+
+// 任务依赖图：节点是连续的整数下标（删除时与末尾交换），邻接表存下标而不是ID
+// 正向边 task -> dependency 表示 task 依赖 dependency，反向边用于“它阻塞了谁”
+// 同时维护动态拓扑序号（Pearce-Kelly）：新边符合现有顺序时不必搜索，否则只在两端序号之间的区域内查环并调整
+// 只在界面线程使用：遍历用的访问标记是可变成员，const 查询也不能并发调用
+class DependencyGraph
+{
+public:
+    DependencyGraph();
+
+    int nodeCount() const { return m_ids.size(); }
+    int edgeCount() const { return m_edgeCount; }
+    bool contains(TaskId id) const { return m_nodes.contains(id); }
+    void clear();
+
+    // 用给定列表替换任务的全部依赖，不检查环（加载数据库中已有的数据时使用）
+    // 节点只为 id 本身创建：列表中还不在图中的依赖被跳过，由调用方在那个任务加入后重新设置
+    void setDependencies(TaskId id, const QVector<TaskId> &dependencyIds);
+    // 添加 id 依赖 dependencyId 的边；任一端不在图中或会形成环（包括依赖自身）时拒绝并返回 false
+    bool addEdge(TaskId id, TaskId dependencyId);
+    void removeEdge(TaskId id, TaskId dependencyId);
+    // dependencyId 已经（直接或间接）依赖 id 时，再加这条边就会成环；最坏 O(V+E)
+    bool wouldCreateCycle(TaskId id, TaskId dependencyId) const;
+    // 删除节点和与它相连的所有边，只触及直接相邻的节点
+    void removeNode(TaskId id);
+
+    QVector<TaskId> dependencies(TaskId id) const;
+    // 直接依赖 id 的任务
+    QVector<TaskId> dependents(TaskId id) const;
+    // 传递闭包查询（悬停高亮、环检测提示）：结果按任务缓存，边或节点变化时只作废受影响的缓存项
+    // 直接或间接依赖 id 的全部任务，即 id 完成前被阻塞的任务
+    QVector<TaskId> blockedTasks(TaskId id) const;
+    // id 直接或间接依赖的全部任务
+    QVector<TaskId> upstreamTasks(TaskId id) const;
+    // id 是否直接或间接依赖 other
+    bool dependsOn(TaskId id, TaskId other) const;
+
+    // 已有数据中的环：去掉返回的这些边后图中不再有环；无环时为空
+    // 有环期间 addEdge 和 wouldCreateCycle 只能退回完整搜索，加载完成后应由调用方断开这些边
+    QVector<QPair<TaskId, TaskId>> cycleEdges() const;
+
+    // 依赖在前的拓扑顺序；已有数据中存在环时，环上的节点按任意顺序排在最后并返回 false
+    bool topologicalOrder(QVector<TaskId> &order) const;
+    bool topologicalNodes(QVector<int> &order) const;
+
+    // 按节点下标遍历（排期等批量算法使用），删除节点后下标可能改变，不能跨修改保存
+    int nodeIndex(TaskId id) const { return find(id); }
+    TaskId idAt(int node) const { return m_ids.at(node); }
+    const QVector<int> &dependencyNodes(int node) const { return m_forward.at(node); }
+    const QVector<int> &dependentNodes(int node) const { return m_reverse.at(node); }
+    // 拓扑序号：依赖的序号总是小于依赖它的任务，序号不连续；已有数据中有环时只是近似
+    int orderOf(int node) const;
+
+private:
+    // 一个任务的传递闭包：按节点下标的位图用于 O(1) 判断成员和作废检查，ID 列表直接返回给调用方
+    struct Closure
+    {
+        QBitArray members;
+        QVector<TaskId> ids;
+        bool contains(int node) const { return node < members.size() && members.testBit(node); }
+    };
+
+    int nodeOf(TaskId id);
+    // 返回的指针在下一次查询闭包之前有效
+    const Closure *closure(int node, bool downstream) const;
+    // 边 node -> dep 增加或删除：上游闭包包含 node 的、下游闭包包含 dep 的才会变化
+    void invalidateClosures(int node, int dep);
+    int find(TaskId id) const { return m_nodes.value(id, -1); }
+    // 从 start 出发沿正向（或反向）边遍历，返回是否到达 target；target 为 -1 时遍历全部可达节点
+    bool reach(int start, int target, bool reverse, QVector<int> *visited) const;
+    quint32 nextEpoch() const;
+    // 加入边 node -> dep 前调整序号，使 dep 排在 node 之前；会成环时返回 false 且不修改
+    bool reorder(int node, int dep);
+    void ensureOrder() const;
+    void markOrderStale(int node, int dep);
+
+    QVector<TaskId> m_ids;
+    QHash<TaskId, int> m_nodes;
+    QVector<QVector<int>> m_forward;     // 依赖的节点
+    QVector<QVector<int>> m_reverse;     // 依赖它的节点
+    int m_edgeCount;
+
+    // 遍历的访问标记：标记等于当前轮次即已访问，每次遍历不必清零整个数组
+    mutable QVector<quint32> m_marks;
+    mutable quint32 m_epoch;
+
+    // 节点的拓扑序号；加载未检查的数据后标记为过期，下次使用前整体重排
+    mutable QVector<int> m_order;
+    mutable int m_nextOrder;
+    mutable bool m_orderStale;
+    mutable bool m_acyclic;
+
+    // 最近查询过的闭包，按任务ID缓存（节点下标会因删除而改变）
+    mutable QCache<TaskId, Closure> m_upstreamClosures;
+    mutable QCache<TaskId, Closure> m_downstreamClosures;
+    static const int CLOSURE_CACHE_SIZE = 128;
+};
+
+#endif // DEPENDENCYGRAPH_H
@@ -0,0 +1,26 @@
+﻿#include "filterworker.h"
+
+FilterWorker::FilterWorker(QObject *parent)
+    : QObject(parent),
+      m_latestRequest(0)
+{
+}
+
+void FilterWorker::supersede(int request)
+{
+    m_latestRequest.store(request);
+}
+
+void FilterWorker::evaluate(int request, const TaskFilterIndex &index, const NameTable &assignees, const TaskFilter &filter)
+{
+    // 排队期间已有更新的请求，直接跳过
+    if (m_latestRequest.load() != request) {
+        return;
+    }
+    
+    QSet<TaskId> visible;
+    if (!index.evaluate(filter, assignees, visible, &m_latestRequest, request)) {
+        return;
+    }
+    emit finished(request, visible);
+}
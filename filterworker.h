@@ -0,0 +1,33 @@
+#ifndef FILTERWORKER_H
+#define FILTERWORKER_H
+
+#include <QObject>
+#include <QSet>
+#include <QAtomicInt>
+#include "taskrecord.h"
+#include "taskfilter.h"
+#include "nametable.h"
+
+// 后台筛选线程：对模型索引的只读副本求出可见任务，界面线程只应用显隐差异
+// 每个请求带递增的序号，更新的请求到来后旧请求在检查点放弃，结果也不再发出
+class FilterWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FilterWorker(QObject *parent = nullptr);
+
+    // 可从任意线程调用：登记最新的请求序号，之前的请求随之作废
+    void supersede(int request);
+
+    // 在工作线程中执行，参数都是隐式共享的副本
+    void evaluate(int request, const TaskFilterIndex &index, const NameTable &assignees, const TaskFilter &filter);
+
+signals:
+    void finished(int request, const QSet<TaskId> &visible);
+
+private:
+    QAtomicInt m_latestRequest;
+};
+
+#endif // FILTERWORKER_H
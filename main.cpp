@@ -1,9 +1,40 @@
 ﻿#include "mainwindow.h"
+#include "benchmarks.h"
+#include "taskexporter.h"
+#include "taskjournal.h"
+#include "taskrepository.h"
 #include <QApplication>
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QStyleFactory>
 #include <QFont>
+#include <QTextStream>
+
+// 无界面导出整板，供夜间数据仓库任务调用：QtConsoleApplication1 --export tasks.ndjson.gz
+static int runExport(const QString &filePath)
+{
+    {
+        TaskRepository repository("migrate");
+        if (!repository.open("tasks.db", true)) {
+            return 1;
+        }
+        // 没有持久化线程替我们折叠日志，导出读取的是表，先把日志尾部折叠进去
+        TaskJournal::compact(repository);
+    }
+    
+    bool result = false;
+    TaskExporter exporter("tasks.db", filePath, filePath.endsWith(".gz", Qt::CaseInsensitive));
+    QObject::connect(&exporter, &TaskExporter::finished,
+                     [&result](bool ok, int exportedCount, qint64 bytesWritten, qint64 elapsedMs) {
+        result = ok;
+        double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+        QTextStream(stdout) << exportedCount << " tasks, " << bytesWritten << " bytes in " << elapsedMs << " ms ("
+                            << qRound64(exportedCount / seconds) << " tasks/s, "
+                            << bytesWritten / (1024.0 * 1024.0) / seconds << " MB/s)\n";
+    });
+    exporter.exportFile();
+    return result ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
@@ -13,6 +44,24 @@ int main(int argc, char *argv[])
     
     QApplication a(argc, argv);
     
+    // 无界面运行性能基准
+    if (QApplication::arguments().contains("--bench-startup")) {
+        return Benchmarks::runStartup();
+    }
+    if (QApplication::arguments().contains("--bench-search")) {
+        return Benchmarks::runSearch();
+    }
+    if (QApplication::arguments().contains("--bench-report")) {
+        return Benchmarks::runReport();
+    }
+    if (QApplication::arguments().contains("--bench-schedule")) {
+        return Benchmarks::runSchedule();
+    }
+    int exportIndex = QApplication::arguments().indexOf("--export");
+    if (exportIndex >= 0 && exportIndex + 1 < QApplication::arguments().size()) {
+        return runExport(QApplication::arguments().at(exportIndex + 1));
+    }
+    
     // 设置应用程序样式
     QApplication::setStyle(QStyleFactory::create("Fusion"));
     
@@ -20,10 +20,47 @@
 #include <QGraphicsLineItem>
 #include "reportdialog.h"
 #include <QScreen>
+#include <QStatusBar>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <algorithm>
+#include <climits>
+#include "taskjournal.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     ui(new Ui::MainWindow),
+      m_repository("main"),
+      m_persistenceThread(nullptr),
+      m_persistence(nullptr),
+      m_compactTicket(0),
+      m_model(nullptr),
+      m_projectCombo(nullptr),
+      m_projectFiltered(false),
+      m_loaderThread(nullptr),
+      m_loader(nullptr),
+      m_loadTimer(nullptr),
+      m_loaderFinished(false),
+      m_loadedFromSnapshot(false),
+      m_boardLoaded(false),
+      m_loadRequest(0),
+      m_snapshotStale(false),
+      m_firstCardMs(-1),
+      m_importThread(nullptr),
+      m_importer(nullptr),
+      m_exportThread(nullptr),
+      m_exporter(nullptr),
+      m_reportThread(nullptr),
+      m_reportBuilder(nullptr),
+      m_filterThread(nullptr),
+      m_filterWorker(nullptr),
+      m_filterTimer(nullptr),
+      m_filterRequest(0),
+      m_filterPending(false),
+      m_searchActive(false),
+      m_searchReordered(false),
+      m_searchRequest(0),
+      m_filterActive(false),
       todoColumn(nullptr),
       inProgressColumn(nullptr),
       doneColumn(nullptr),
@@ -44,6 +81,36 @@ MainWindow::MainWindow(QWidget *parent)
     ui->setupUi(this);
     showMaximized();
     setWindowTitle(QString::fromLocal8Bit("任务管理系统"));
+    m_descriptionCache.setMaxCost(DESCRIPTION_CACHE_CHARS);
+    
+    // 任务数据保存在模型中，卡片只负责显示；模型中的记录变化时重绘对应卡片
+    // 状态在别处改变（编辑对话框等）时卡片移到新列的末尾，拖放在改状态前已经放好位置
+    m_model = new TaskModel(this);
+    connect(m_model, &TaskModel::taskChanged, this, [this](TaskId id, int fields) {
+        TaskCard *card = cardById(id);
+        if (!card) {
+            return;
+        }
+        int column = columnOf(card);
+        if ((fields & TaskRecord::DirtyStatus) && column != card->status()) {
+            if (column >= 0) {
+                m_columns[column].remove(card);
+            }
+            m_columns[card->status()].append(card);
+        }
+        card->update();
+        if (fields & (TaskRecord::DirtyDeadline | TaskRecord::DirtyAssignee)) {
+            refilterCard(card);
+        }
+        // 显示中的依赖线和依赖链高亮是按旧的边画的，下次悬停时重新绘制
+        if (fields & TaskRecord::DirtyDependencies) {
+            clearDependencyLines();
+        }
+        // 排期变化会影响上下游任务的卡片，场景的重绘请求会合并成一次
+        if (fields & (TaskRecord::DirtyDeadline | TaskRecord::DirtyProgress | TaskRecord::DirtyStatus | TaskRecord::DirtyDependencies)) {
+            m_scene->update();
+        }
+    });
     
     m_scene = new QGraphicsScene(this);
     ui->graphicsView->setScene(m_scene);
@@ -63,8 +130,18 @@ MainWindow::MainWindow(QWidget *parent)
     
     setupColumns();
     setupZoomControls();
+    setupProjectSwitcher();
+    setupBulkActions();
     setupTaskDialog();
     
+    // 排期以当前时间为基准，定时整体重算一次
+    QTimer *scheduleTimer = new QTimer(this);
+    connect(scheduleTimer, &QTimer::timeout, this, [this]() {
+        m_model->refreshSchedule();
+        m_scene->update();
+    });
+    scheduleTimer->start(SCHEDULE_REFRESH_MS);
+    
     m_startDateEdit = ui->startDateEdit;
     m_endDateEdit = ui->endDateEdit;
     m_assigneeFilterEdit = ui->assigneeFilterEdit;
@@ -76,18 +153,54 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->deleteButton, &QPushButton::clicked, this, &MainWindow::onDeleteButtonClicked);
     connect(ui->clearButton, &QPushButton::clicked, this, &MainWindow::onClearButtonClicked);
     connect(ui->reportButton, &QPushButton::clicked, this, &MainWindow::onReportButtonClicked);
+    connect(ui->importButton, &QPushButton::clicked, this, &MainWindow::onImportButtonClicked);
+    connect(ui->exportButton, &QPushButton::clicked, this, &MainWindow::onExportButtonClicked);
     connect(ui->filterButton, &QPushButton::clicked, this, &MainWindow::onFilterButtonClicked);
     connect(ui->clearFilterButton, &QPushButton::clicked, this, &MainWindow::onClearFilterButtonClicked);
+    connect(ui->searchEdit, &QLineEdit::returnPressed, this, &MainWindow::onSearchTriggered);
+    connect(ui->searchEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+        if (!text.isEmpty()) {
+            return;
+        }
+        if (m_searchActive) {
+            onSearchTriggered();
+        } else {
+            ++m_searchRequest;      // 清空输入框时作废尚未返回的搜索
+        }
+    });
+    
+    // 负责人和日期边输入边筛选，连续输入时只在停顿后求值一次
+    m_filterTimer = new QTimer(this);
+    m_filterTimer->setSingleShot(true);
+    m_filterTimer->setInterval(FILTER_DEBOUNCE_MS);
+    connect(m_filterTimer, &QTimer::timeout, this, &MainWindow::requestFilter);
+    connect(m_assigneeFilterEdit, &QLineEdit::textChanged, m_filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_startDateEdit, &QDateTimeEdit::dateTimeChanged, m_filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_endDateEdit, &QDateTimeEdit::dateTimeChanged, m_filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     
     initDatabase();
+    startPersistence();
+    startFilterWorker();
+    refreshProjectList();
     loadTasks();
     setupScene();
 }
 
 MainWindow::~MainWindow()
 {
+    stopImport();
+    stopExport();
+    stopReport();
+    stopLoading();
     saveTasks();
     
+    // 正常退出时刷新快照，下次启动可直接映射
+    if (m_boardLoaded && m_snapshotStale) {
+        writeSnapshot();
+    }
+    stopPersistence();
+    stopFilterWorker();
+    
     if (m_taskDialog) {
         delete m_taskDialog;
         m_taskDialog = nullptr;
@@ -125,6 +238,11 @@ void MainWindow::setupColumns()
     todoColumn = m_scene->addRect(leftMargin, 70, columnWidth, columnHeight, columnPen, columnBrush);
     inProgressColumn = m_scene->addRect(leftMargin + columnWidth + columnSpacing, 70, columnWidth, columnHeight, columnPen, columnBrush);
     doneColumn = m_scene->addRect(leftMargin + (columnWidth + columnSpacing) * 2, 70, columnWidth, columnHeight, columnPen, columnBrush);
+    
+    QGraphicsRectItem *columns[3] = { todoColumn, inProgressColumn, doneColumn };
+    for (int i = 0; i < 3; ++i) {
+        m_columns[i].setGeometry(columns[i]->rect().x() + 25, columns[i]->rect().y() + 20, 20);
+    }
 }
 
 void MainWindow::setupTaskDialog()
@@ -208,200 +326,491 @@ void MainWindow::setupTaskDialog()
 
 void MainWindow::initDatabase()
 {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName("tasks.db");
-    
-    if (!m_db.open()) {
-        qDebug() << "Error: connection with database failed";
-    } else {
+    // 主连接只负责按 user_version 执行结构迁移，读写都在各自线程的仓库连接上进行
+    if (m_repository.open("tasks.db", true)) {
         qDebug() << "Database: connection ok";
     }
+}
+
+void MainWindow::startPersistence()
+{
+    // 持久化工作对象拥有自己的数据库连接，在独立线程中提交
+    m_persistenceThread = new QThread(this);
+    m_persistence = new PersistenceWorker(m_repository.databasePath());
+    m_persistence->moveToThread(m_persistenceThread);
+    qRegisterMetaType<QVector<TaskId>>("QVector<TaskId>");
+    connect(m_persistence, &PersistenceWorker::compacted, this, &MainWindow::onCompacted);
+    connect(m_persistence, &PersistenceWorker::searchFinished, this, &MainWindow::onSearchFinished);
+    m_persistenceThread->start();
+    
+    QMetaObject::invokeMethod(m_persistence, &PersistenceWorker::open, Qt::QueuedConnection);
+}
+
+void MainWindow::stopPersistence()
+{
+    if (!m_persistenceThread) {
+        return;
+    }
     
-    QSqlQuery query;
+    // 阻塞等待后台线程写完所有剩余变更，保证退出时不丢数据
+    QMetaObject::invokeMethod(m_persistence, &PersistenceWorker::close, Qt::BlockingQueuedConnection);
+    m_persistenceThread->quit();
+    m_persistenceThread->wait();
+    m_afterCompaction.clear();
     
-    // 创建任务表，添加id和progress字段
-    query.exec("CREATE TABLE IF NOT EXISTS tasks ("
-              "id TEXT PRIMARY KEY, "
-              "title TEXT, "
-              "description TEXT, "
-              "status INTEGER, "
-              "priority INTEGER, "
-              "deadline TEXT, "
-              "assignee TEXT, "
-              "progress INTEGER, "
-              "project_id TEXT)");
+    delete m_persistence;
+    m_persistence = nullptr;
+    delete m_persistenceThread;
+    m_persistenceThread = nullptr;
+}
+
+void MainWindow::startFilterWorker()
+{
+    // 筛选线程不访问数据库，只读取模型索引的副本
+    qRegisterMetaType<QSet<TaskId>>("QSet<TaskId>");
+    m_filterThread = new QThread(this);
+    m_filterWorker = new FilterWorker();
+    m_filterWorker->moveToThread(m_filterThread);
+    connect(m_filterWorker, &FilterWorker::finished, this, &MainWindow::onFilterReady);
+    m_filterThread->start();
+}
+
+void MainWindow::stopFilterWorker()
+{
+    if (!m_filterThread) {
+        return;
+    }
+    
+    m_filterWorker->supersede(++m_filterRequest);
+    m_filterThread->quit();
+    m_filterThread->wait();
     
-    // 添加依赖关系表
-    query.exec("CREATE TABLE IF NOT EXISTS dependencies ("
-              "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-              "task_id TEXT, "
-              "dependency_id TEXT)");
+    delete m_filterWorker;
+    m_filterWorker = nullptr;
+    delete m_filterThread;
+    m_filterThread = nullptr;
+}
+
+void MainWindow::submitChanges(const QVector<TaskChange> &changes)
+{
+    if (changes.isEmpty() || !m_persistence) {
+        return;
+    }
+    m_snapshotStale = true;
+    
+    PersistenceWorker *worker = m_persistence;
+    QMetaObject::invokeMethod(m_persistence, [worker, changes]() {
+        worker->enqueue(changes);
+    }, Qt::QueuedConnection);
 }
 
 void MainWindow::saveTasks()
 {
-    if (!m_db.isOpen()) {
-        qDebug() << "Database is not open, cannot save tasks.";
+    // 模型把脏数据打包成操作日志记录，交给后台线程，GUI线程不再等待数据库
+    submitChanges(m_model->takeChanges());
+}
+
+void MainWindow::afterPersisted(bool fold, const std::function<void()> &next)
+{
+    if (!m_persistence) {
+        next();
         return;
     }
     
-    QSqlQuery query;
+    // 与之前提交的变更在同一个队列中按顺序执行，信号到达时它们都已写入
+    int ticket = ++m_compactTicket;
+    m_afterCompaction.insert(ticket, next);
+    PersistenceWorker *worker = m_persistence;
+    QMetaObject::invokeMethod(m_persistence, [worker, ticket, fold]() {
+        worker->requestCompaction(ticket, fold);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::onCompacted(int ticket)
+{
+    std::function<void()> next = m_afterCompaction.take(ticket);
+    if (next) {
+        next();
+    }
+}
+
+void MainWindow::loadTasks()
+{
+    if (!m_repository.isOpen()) {
+        qDebug() << "Database is not open, cannot load tasks.";
+        return;
+    }
     
-    // 删除之前的所有任务
-    query.exec("DELETE FROM tasks");
+    stopLoading();
+    m_loadClock.start();
     
-    // 保存当前所有任务
-    for (TaskCard *card : m_cards) {
-        query.prepare("INSERT INTO tasks (id, title, description, status, priority, deadline, assignee, progress, project_id) "
-                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        
-        query.addBindValue(card->id());
-        query.addBindValue(card->title());
-        query.addBindValue(card->description());
-        query.addBindValue(static_cast<int>(card->status()));
-        query.addBindValue(static_cast<int>(card->priority()));
-        
-        if (card->deadline().isValid()) {
-            query.addBindValue(card->deadline().toString(Qt::ISODate));
-        } else {
-            query.addBindValue(QString());
-        }
-        
-        query.addBindValue(card->assignee());
-        query.addBindValue(card->progress());
-        query.addBindValue(card->projectId());
-        
-        if (!query.exec()) {
-            qDebug() << "Save task error: " << query.lastError().text();
+    // 清除现有任务
+    removeAllCards();
+    m_model->clear();
+    m_descriptionCache.clear();
+    
+    for (int i = 0; i < 3; ++i) {
+        m_pendingIds[i].clear();
+    }
+    m_loaderFinished = false;
+    m_loadedFromSnapshot = false;
+    m_boardLoaded = false;
+    m_firstCardMs = -1;
+    
+    // 读取前先等持久化线程把已提交的变更写入日志，加载线程会重放日志尾部
+    // 按项目加载时只扫描该项目的索引范围，日志中移入本项目的任务扫描不到，因此先折叠日志
+    int request = ++m_loadRequest;
+    afterPersisted(m_projectFiltered, [this, request]() {
+        if (request == m_loadRequest) {
+            startLoader();
         }
+    });
+}
+
+void MainWindow::startLoader()
+{
+    if (!m_loadTimer) {
+        m_loadTimer = new QTimer(this);
+        m_loadTimer->setInterval(0);
+        connect(m_loadTimer, &QTimer::timeout, this, &MainWindow::processLoadSlice);
+    }
+    
+    // SQL 读取和行解码在后台线程进行，GUI线程只负责创建卡片
+    qRegisterMetaType<QVector<TaskRecord>>("QVector<TaskRecord>");
+    m_loaderThread = new QThread(this);
+    m_loader = new TaskLoader(m_repository.databasePath());
+    if (m_projectFiltered) {
+        m_loader->setProject(m_activeProject);
+    }
+    m_loader->moveToThread(m_loaderThread);
+    connect(m_loaderThread, &QThread::started, m_loader, &TaskLoader::load);
+    connect(m_loader, &TaskLoader::recordsLoaded, this, &MainWindow::onRecordsLoaded);
+    connect(m_loader, &TaskLoader::finished, this, &MainWindow::onLoaderFinished);
+    m_loaderThread->start();
+}
+
+void MainWindow::stopLoading()
+{
+    if (m_loadTimer) {
+        m_loadTimer->stop();
     }
     
-    // 保存依赖关系
-    QSqlQuery depQuery;
-    depQuery.exec("DELETE FROM dependencies");
+    if (!m_loaderThread) {
+        return;
+    }
     
-    for (TaskCard* card : m_cards) {
-        for (TaskCard* depCard : card->dependencies()) {
-            depQuery.prepare("INSERT INTO dependencies (task_id, dependency_id) VALUES (?, ?)");
-            depQuery.addBindValue(card->id());
-            depQuery.addBindValue(depCard->id());
-            depQuery.exec();
+    m_loader->cancel();
+    m_loaderThread->quit();
+    m_loaderThread->wait();
+    
+    delete m_loader;
+    m_loader = nullptr;
+    delete m_loaderThread;
+    m_loaderThread = nullptr;
+}
+
+void MainWindow::onRecordsLoaded(const QVector<TaskRecord> &records)
+{
+    // 忽略已取消的加载线程发出的残留信号
+    if (sender() != m_loader) {
+        return;
+    }
+    
+    // 记录先整批进入模型（依赖关系按ID保存，无需等所有卡片创建后再解析），卡片按列排队分片创建
+    // 占位记录只存在于模型中，不创建卡片
+    m_model->insertLoaded(records);
+    for (const TaskRecord &record : records) {
+        if (!record.stub) {
+            int column = qBound(0, record.status, 2);
+            m_pendingIds[column].enqueue(record.id);
         }
     }
+    
+    if (!m_loadTimer->isActive()) {
+        m_loadTimer->start();
+    }
 }
 
-void MainWindow::loadTasks()
+void MainWindow::onLoaderFinished(int taskCount, qint64 readMs, bool fromSnapshot)
 {
-    if (!m_db.isOpen()) {
-        qDebug() << "Database is not open, cannot load tasks.";
+    if (sender() != m_loader) {
         return;
     }
     
-    // 清除现有任务
-    for (TaskCard *card : m_cards) {
-        m_scene->removeItem(card);
-        delete card;
+    qDebug() << "Loader: read" << taskCount << "tasks in" << readMs << "ms"
+             << (fromSnapshot ? "from snapshot" : "from database");
+    m_loadedFromSnapshot = fromSnapshot;
+    
+    m_loaderThread->quit();
+    m_loaderThread->wait();
+    delete m_loader;
+    m_loader = nullptr;
+    delete m_loaderThread;
+    m_loaderThread = nullptr;
+    
+    m_loaderFinished = true;
+    if (!m_loadTimer->isActive()) {
+        finishLoading();
     }
-    m_cards.clear();
+}
+
+void MainWindow::processLoadSlice()
+{
+    QElapsedTimer slice;
+    slice.start();
     
-    QSqlQuery query("SELECT id, title, description, status, priority, deadline, assignee, progress, project_id FROM tasks");
-    
-    // 加载所有任务
-    while (query.next()) {
-        QString id = query.value(0).toString();
-        QString title = query.value(1).toString();
-        QString description = query.value(2).toString();
-        int statusInt = query.value(3).toInt();
-        int priorityInt = query.value(4).toInt();
-        QString deadlineStr = query.value(5).toString();
-        QString assignee = query.value(6).toString();
-        int progress = query.value(7).toInt();
-        QString projectId = query.value(8).toString();
-        
-        QDateTime deadline;
-        if (!deadlineStr.isEmpty()) {
-            deadline = QDateTime::fromString(deadlineStr, Qt::ISODate);
-        }
-        
-        TaskCard::Status status = static_cast<TaskCard::Status>(statusInt);
-        TaskCard::Priority priority = static_cast<TaskCard::Priority>(priorityInt);
+    bool created = true;
+    while (created && slice.elapsed() < LOAD_SLICE_MS) {
+        created = false;
         
-        TaskCard *card = new TaskCard(title, description, priority, status, deadline, assignee, projectId);
-        card->setId(id);
-        card->setProgress(progress);
-        
-        m_scene->addItem(card);
-        m_cards.append(card);
-        
-        // 连接任务卡片的信号
-        connect(card, &TaskCard::cardReleased, this, &MainWindow::updateCardStatusByPosition);
-        connect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::showTaskDetails);
-        connect(card, &TaskCard::cardHovered, this, [this, card]() {
-            if (!card->dependencies().isEmpty()) {
-                drawDependencyLines(card);
+        // 三列轮流各取一张，使每一列的首屏同时出现
+        for (int column = 0; column < 3; ++column) {
+            if (!m_pendingIds[column].isEmpty()) {
+                createLoadedCard(m_pendingIds[column].dequeue());
+                created = true;
             }
-        });
+        }
     }
     
-    // 在加载所有任务后，设置依赖关系（因为需要先创建所有任务对象）
-    QSqlQuery depQuery("SELECT task_id, dependency_id FROM dependencies");
-    QMap<QString, TaskCard*> cardMap;
-    
-    // 构建ID到卡片的映射
-    for (TaskCard* card : m_cards) {
-        cardMap[card->id()] = card;
+    if (!created) {
+        m_loadTimer->stop();
+        if (m_loaderFinished) {
+            finishLoading();
+        }
+    }
+}
+
+TaskCard *MainWindow::createCard(TaskId id)
+{
+    TaskCard *card = new TaskCard(m_model, id);
+    m_scene->addItem(card);
+    m_cardSlots.insert(id, m_cards.size());
+    m_cards.append(card);
+    connectCardSignals(card);
+    // 筛选生效期间创建的卡片（分批加载、导入、新建）同样按当前条件决定是否显示
+    refilterCard(card);
+    // 新卡片放在所属列的末尾，只摆放这一张
+    m_columns[card->status()].append(card);
+    return card;
+}
+
+TaskCard *MainWindow::cardById(TaskId id) const
+{
+    int slot = m_cardSlots.value(id, -1);
+    return slot >= 0 ? m_cards.at(slot) : nullptr;
+}
+
+void MainWindow::removeCard(TaskCard *card)
+{
+    int column = columnOf(card);
+    if (column >= 0) {
+        m_columns[column].remove(card);
+    }
+    unregisterCard(card);
+}
+
+void MainWindow::unregisterCard(TaskCard *card)
+{
+    // 末尾的卡片填入空位，删除是 O(1)；调用方已把卡片从列中移除
+    int slot = m_cardSlots.take(card->id());
+    m_visibleIds.remove(card->id());
+    TaskCard *last = m_cards.takeLast();
+    if (last != card) {
+        m_cards[slot] = last;
+        m_cardSlots.insert(last->id(), slot);
     }
     
-    // 设置依赖关系
-    while (depQuery.next()) {
-        QString taskId = depQuery.value(0).toString();
-        QString depId = depQuery.value(1).toString();
-        
-        if (cardMap.contains(taskId) && cardMap.contains(depId)) {
-            cardMap[taskId]->addDependency(cardMap[depId]);
+    if (m_currentEditCard == card) {
+        m_currentEditCard = nullptr;
+    }
+    m_scene->removeItem(card);
+    delete card;
+}
+
+void MainWindow::removeAllCards()
+{
+    clearDependencyLines();
+    m_currentEditCard = nullptr;
+    for (TaskCard *card : m_cards) {
+        m_scene->removeItem(card);
+        delete card;
+    }
+    m_cards.clear();
+    m_cardSlots.clear();
+    m_visibleIds.clear();
+    m_filterActive = false;
+    m_filterPending = false;
+    if (m_filterWorker) {
+        m_filterWorker->supersede(++m_filterRequest);
+    }
+    for (ColumnLayout &column : m_columns) {
+        column.clear();
+    }
+}
+
+int MainWindow::columnOf(const TaskCard *card) const
+{
+    for (int i = 0; i < 3; ++i) {
+        if (m_columns[i].contains(card)) {
+            return i;
         }
     }
+    return -1;
+}
+
+void MainWindow::refilterCard(TaskCard *card)
+{
+    // 后台正在求值的集合基于修改前的索引快照，返回后会覆盖这里的结果：作废它，停顿后用新快照重新求值
+    if (m_filterPending) {
+        m_filterWorker->supersede(++m_filterRequest);
+        m_filterTimer->start();
+    }
+    if (!m_filterActive) {
+        return;
+    }
     
-    arrangeCards();
+    bool visible = m_model->filterIndex().matches(card->id(), currentFilter(), m_model->assignees());
+    if (visible) {
+        m_visibleIds.insert(card->id());
+    } else {
+        m_visibleIds.remove(card->id());
+    }
+    int firstChanged[3] = { INT_MAX, INT_MAX, INT_MAX };
+    setCardVisible(card, visible, firstChanged);
+    for (int i = 0; i < 3; ++i) {
+        if (firstChanged[i] != INT_MAX) {
+            m_columns[i].relayout(firstChanged[i]);
+        }
+    }
 }
 
-void MainWindow::arrangeCards()
+void MainWindow::setCardVisible(TaskCard *card, bool visible, int firstChanged[3])
 {
-    const int cardSpacing = 20;
-    qreal todoY = todoColumn->rect().y() + 20;
-    qreal inProgressY = inProgressColumn->rect().y() + 20;
-    qreal doneY = doneColumn->rect().y() + 20;
+    // 记录每列第一个显隐变化的位置，之后只从那里重排
+    if (card->isVisible() == visible) {
+        return;
+    }
+    card->setVisible(visible);
+    int column = columnOf(card);
+    if (column >= 0) {
+        firstChanged[column] = qMin(firstChanged[column], m_columns[column].indexOf(card));
+    }
+}
+
+void MainWindow::clearDependencyLines()
+{
+    for (QGraphicsItem *item : m_dependencyLines) {
+        m_scene->removeItem(item);
+        delete item;
+    }
+    m_dependencyLines.clear();
     
-    QList<QGraphicsItem*> items = m_scene->items();
-    QList<TaskCard*> todoCards;
-    QList<TaskCard*> inProgressCards;
-    QList<TaskCard*> doneCards;
+    for (TaskId id : m_highlightedIds) {
+        if (TaskCard *card = cardById(id)) {
+            card->setHighlight(TaskCard::NoHighlight);
+        }
+    }
+    m_highlightedIds.clear();
+}
 
-    for (QGraphicsItem *item : items) {
-        TaskCard *card = dynamic_cast<TaskCard*>(item);
-        if (card && card->isVisible()) {
-            switch (card->status()) {
-                case TaskCard::Todo: todoCards.append(card); break;
-                case TaskCard::InProgress: inProgressCards.append(card); break;
-                case TaskCard::Done: doneCards.append(card); break;
-            }
+void MainWindow::highlightDependencyChain(TaskCard *card)
+{
+    // 闭包由依赖图缓存，反复悬停同一条链上的卡片不再遍历图；只有在场景中的卡片需要高亮
+    const DependencyGraph &graph = m_model->dependencyGraph();
+    for (TaskId id : graph.upstreamTasks(card->id())) {
+        if (TaskCard *other = cardById(id)) {
+            other->setHighlight(TaskCard::UpstreamHighlight);
+            m_highlightedIds.append(id);
+        }
+    }
+    for (TaskId id : graph.blockedTasks(card->id())) {
+        if (TaskCard *other = cardById(id)) {
+            other->setHighlight(TaskCard::DownstreamHighlight);
+            m_highlightedIds.append(id);
         }
     }
+}
 
-    for (TaskCard *card : todoCards) {
-        card->setPos(todoColumn->rect().x() + 25, todoY);
-        todoY += card->boundingRect().height() + cardSpacing;
+void MainWindow::createLoadedCard(TaskId id)
+{
+    // 排队期间任务可能已被删除
+    if (!m_model->contains(id) || m_cardSlots.contains(id)) {
+        return;
     }
-    for (TaskCard *card : inProgressCards) {
-        card->setPos(inProgressColumn->rect().x() + 25, inProgressY);
-        inProgressY += card->boundingRect().height() + cardSpacing;
+    
+    // 加载期间卡片依次追加到列尾，每张只摆放一次
+    createCard(id);
+    
+    if (m_firstCardMs < 0) {
+        m_firstCardMs = m_loadClock.elapsed();
     }
-    for (TaskCard *card : doneCards) {
-        card->setPos(doneColumn->rect().x() + 25, doneY);
-        doneY += card->boundingRect().height() + cardSpacing;
+}
+
+void MainWindow::finishLoading()
+{
+    qint64 totalMs = m_loadClock.elapsed();
+    qDebug() << "Board loaded:" << m_cards.size() << "tasks," << m_model->count() - m_cards.size() << "cross-project stubs, first card after"
+             << m_firstCardMs << "ms, fully loaded after" << totalMs << "ms";
+    statusBar()->showMessage(QString::fromLocal8Bit("已加载 %1 个任务：首张卡片 %2 ms，全部加载 %3 ms")
+                             .arg(m_cards.size()).arg(qMax<qint64>(m_firstCardMs, 0)).arg(totalMs), 10000);
+    
+    m_model->finishLoading();
+    m_boardLoaded = true;
+    m_snapshotStale = !m_loadedFromSnapshot;
+    if (m_snapshotStale && !m_projectFiltered) {
+        // 快照缺失或过期，加载完成后由持久化线程在后台重新生成
+        writeSnapshot();
     }
 }
 
+void MainWindow::writeSnapshot()
+{
+    // 快照保存整个看板，只显示一个项目时不能覆盖它
+    if (!m_persistence || m_projectFiltered) {
+        return;
+    }
+    
+    // 先提交未保存的修改，使快照内容与日志序号对应
+    saveTasks();
+    
+    QVector<TaskRecord> records = m_model->snapshot();
+    
+    PersistenceWorker *worker = m_persistence;
+    QMetaObject::invokeMethod(m_persistence, [worker, records]() {
+        worker->writeSnapshot(records);
+    }, Qt::QueuedConnection);
+    m_snapshotStale = false;
+}
+
+QString MainWindow::descriptionFor(TaskCard *card)
+{
+    if (card->isDescriptionLoaded()) {
+        return card->description();
+    }
+    
+    if (QString *cached = m_descriptionCache.object(card->id())) {
+        return *cached;
+    }
+    
+    // 完整描述不常驻在卡片中，按需从数据库读取后放入 LRU 缓存
+    QString description;
+    if (!TaskJournal::loadDescription(m_repository, card->id(), description)) {
+        return card->descriptionPreview();
+    }
+    m_descriptionCache.insert(card->id(), new QString(description), qMax(1, description.size()));
+    return description;
+}
+
+void MainWindow::connectCardSignals(TaskCard *card)
+{
+    connect(card, &TaskCard::cardReleased, this, &MainWindow::updateCardStatusByPosition);
+    connect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::showTaskDetails);
+    connect(card, &TaskCard::cardHovered, this, [this, card]() {
+        drawDependencyLines(card);
+        highlightDependencyChain(card);
+    });
+}
+
 TaskCard::Status MainWindow::getStatusFromPosition(qreal x)
 {
     qreal sceneWidth = m_scene->width();
@@ -473,16 +882,23 @@ void MainWindow::onTaskDialogAccepted()
     QString assignee = m_assigneeEdit->text().trimmed();
     
     if (m_currentEditCard) {
-        m_currentEditCard->setTitle(title);
-        m_currentEditCard->setDescription(description);
-        m_currentEditCard->setPriority(priority);
-        m_currentEditCard->setStatus(status);
-        m_currentEditCard->setDeadline(deadline);
-        m_currentEditCard->setAssignee(assignee);
+        TaskRecord values;
+        values.title = title;
+        values.description = description;
+        values.priority = priority;
+        values.status = status;
+        values.deadline = deadline;
+        values.assignee = assignee;
         
-        m_currentEditCard = nullptr;
+        int fields = TaskRecord::DirtyTitle | TaskRecord::DirtyPriority | TaskRecord::DirtyStatus
+                   | TaskRecord::DirtyDeadline | TaskRecord::DirtyAssignee;
+        if (description != descriptionFor(m_currentEditCard)) {
+            fields |= TaskRecord::DirtyDescription;
+            m_descriptionCache.remove(m_currentEditCard->id());
+        }
+        m_model->update(m_currentEditCard->id(), values, fields);
         
-        arrangeCards();
+        m_currentEditCard = nullptr;
     } 
     else {
         createNewTask(title, description, priority, status, deadline, assignee);
@@ -499,59 +915,142 @@ void MainWindow::createNewTask(const QString &title, const QString &description,
                            TaskCard::Priority priority, TaskCard::Status status, 
                            const QDateTime &deadline, const QString& assignee)
 {
-    TaskCard *card = new TaskCard(title, description, priority, status, deadline, assignee);
+    TaskRecord record;
+    record.title = title;
+    record.description = description;
+    record.priority = priority;
+    record.status = status;
+    record.deadline = deadline;
+    record.assignee = assignee;
+    // 新任务归入当前显示的项目
+    record.projectId = m_projectFiltered ? m_activeProject : QString();
     
     // 初始进度设置，根据状态自动给予默认值
     if (status == TaskCard::Done) {
-        card->setProgress(100);
+        record.progress = 100;
     } else if (status == TaskCard::InProgress) {
-        card->setProgress(50);
+        record.progress = 50;
     } else {
-        card->setProgress(0);
+        record.progress = 0;
     }
     
-    m_scene->addItem(card);
-    m_cards.append(card);
-    
-    // 连接信号槽
-    connect(card, &TaskCard::cardReleased, this, &MainWindow::updateCardStatusByPosition);
-    connect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::showTaskDetails);
-    connect(card, &TaskCard::cardHovered, this, [this, card]() {
-        if (!card->dependencies().isEmpty()) {
-            drawDependencyLines(card);
-        }
-    });
-    
-    arrangeCards();
+    createCard(m_model->create(record));
 }
 
 void MainWindow::onDeleteButtonClicked()
 {
-    QList<QGraphicsItem*> selectedItems = m_scene->selectedItems();
-    for (QGraphicsItem* item : selectedItems) {
-        TaskCard* task = dynamic_cast<TaskCard*>(item);
-        if (task) {
-            m_scene->removeItem(task);
-            delete task;
+    bulkDelete();
+}
+
+QVector<TaskCard*> MainWindow::selectedCards() const
+{
+    QVector<TaskCard*> cards;
+    const QList<QGraphicsItem*> selectedItems = m_scene->selectedItems();
+    for (QGraphicsItem *item : selectedItems) {
+        TaskCard *card = qobject_cast<TaskCard*>(item->toGraphicsObject());
+        if (card) {
+            cards.append(card);
         }
     }
+    return cards;
+}
+
+void MainWindow::bulkMoveToColumn(int status)
+{
+    // 先按列批量摘下卡片、整体追加到目标列，再改模型；
+    // taskChanged 处理时卡片已在新列中，不会再逐张移动
+    QSet<TaskCard*> leaving[3];
+    QVector<TaskCard*> moving;
+    QVector<TaskId> ids;
+    for (TaskCard *card : selectedCards()) {
+        int column = columnOf(card);
+        if (card->status() == status && column == status) {
+            continue;
+        }
+        if (column >= 0) {
+            leaving[column].insert(card);
+        }
+        moving.append(card);
+        ids.append(card->id());
+    }
+    if (ids.isEmpty()) {
+        return;
+    }
     
-    arrangeCards();
+    for (int i = 0; i < 3; ++i) {
+        m_columns[i].removeMany(leaving[i]);
+    }
+    m_columns[status].appendMany(moving);
     
+    TaskRecord values;
+    values.status = status;
+    m_model->updateMany(ids, values, TaskRecord::DirtyStatus);
     saveTasks();
 }
 
-void MainWindow::onClearButtonClicked()
+void MainWindow::bulkUpdate(const TaskRecord &values, int fields)
+{
+    // 负责人、优先级和进度不影响卡片高度和所在列，不需要重排
+    QVector<TaskId> ids;
+    for (TaskCard *card : selectedCards()) {
+        ids.append(card->id());
+    }
+    if (ids.isEmpty()) {
+        return;
+    }
+    m_model->updateMany(ids, values, fields);
+    saveTasks();
+}
+
+void MainWindow::bulkDelete()
 {
-    QSqlQuery query;
-    query.exec("DELETE FROM tasks");
+    const QVector<TaskCard*> cards = selectedCards();
+    if (cards.isEmpty()) {
+        return;
+    }
     
-    QList<QGraphicsItem*> items = m_scene->items();
-    for (QGraphicsItem* item : items) {
-        if (dynamic_cast<TaskCard*>(item)) {
-            m_scene->removeItem(item);
-            delete item;
+    clearDependencyLines();
+    QSet<TaskCard*> leaving[3];
+    QVector<TaskId> ids;
+    ids.reserve(cards.size());
+    for (TaskCard *card : cards) {
+        int column = columnOf(card);
+        if (column >= 0) {
+            leaving[column].insert(card);
         }
+        ids.append(card->id());
+    }
+    for (int i = 0; i < 3; ++i) {
+        m_columns[i].removeMany(leaving[i]);
+    }
+    
+    // 模型同时从其他任务的依赖中移除它们，删除日志在同一个事务中写入
+    m_model->removeMany(ids);
+    for (TaskCard *card : cards) {
+        m_descriptionCache.remove(card->id());
+        unregisterCard(card);
+    }
+    m_scene->update();
+    saveTasks();
+}
+
+void MainWindow::onClearButtonClicked()
+{
+    if (m_projectFiltered) {
+        // 只清空当前项目，其他项目的任务仍留在数据库中
+        m_model->removeAll();
+    } else {
+        TaskChange change;
+        change.kind = TaskChange::ClearAll;
+        submitChanges(QVector<TaskChange>() << change);
+        m_model->clear();
+    }
+    
+    removeAllCards();
+    m_descriptionCache.clear();
+    
+    if (m_projectFiltered) {
+        saveTasks();
     }
 }
 
@@ -562,7 +1061,7 @@ void MainWindow::onCardDoubleClicked(TaskCard *card)
     m_currentEditCard = card;
     
     m_titleEdit->setText(card->title());
-    m_descEdit->setText(card->description());
+    m_descEdit->setText(descriptionFor(card));
     m_priorityCombo->setCurrentIndex(card->priority());
     m_statusCombo->setCurrentIndex(card->status());
     m_assigneeEdit->setText(card->assignee());
@@ -583,30 +1082,218 @@ void MainWindow::updateCardStatusByPosition(TaskCard *card)
     
     TaskCard::Status newStatus = getStatusFromPosition(pos.x());
     
+    // 按卡片中线落下的位置插入目标列，只重排插入点和原位置之后的卡片
+    ColumnLayout &target = m_columns[newStatus];
+    int index = target.indexAt(pos.y() + card->boundingRect().height() / 2);
+    int column = columnOf(card);
+    if (column == newStatus) {
+        target.move(card, index);
+        return;
+    }
+    
+    if (column >= 0) {
+        m_columns[column].remove(card);
+    }
+    target.insert(index, card);
+    
     if (card->status() != newStatus) {
-        card->setStatus(newStatus);
-        
-        arrangeCards();
-        
+        m_model->setStatus(card->id(), newStatus);
         saveTasks();
     }
 }
 
 void MainWindow::onReportButtonClicked()
 {
-    QList<TaskCard*> currentCards;
-    QList<QGraphicsItem*> items = m_scene->items();
-    for (QGraphicsItem *item : items) {
-        TaskCard *card = dynamic_cast<TaskCard*>(item);
-        if (card) {
-            currentCards.append(card);
-        }
+    if (m_reportThread || !m_persistence) {
+        return;
     }
+    
+    // 汇总表随 tasks 表更新，先提交并折叠所有修改，折叠完成后再开始读取
+    ui->reportButton->setEnabled(false);
+    saveTasks();
+    afterPersisted(true, [this]() { startReport(); });
+}
 
-    ReportDialog reportDialog(currentCards, this);
+void MainWindow::startReport()
+{
+    qRegisterMetaType<TaskReport>("TaskReport");
+    m_reportThread = new QThread(this);
+    m_reportBuilder = new ReportBuilder(m_repository.databasePath());
+    m_reportBuilder->moveToThread(m_reportThread);
+    connect(m_reportThread, &QThread::started, m_reportBuilder, &ReportBuilder::build);
+    connect(m_reportBuilder, &ReportBuilder::finished, this, &MainWindow::onReportReady);
+    m_reportThread->start();
+}
+
+void MainWindow::onReportReady(const TaskReport &report)
+{
+    if (sender() != m_reportBuilder) {
+        return;
+    }
+    stopReport();
+    ui->reportButton->setEnabled(true);
+
+    ReportDialog reportDialog(report, this);
     reportDialog.exec();
 }
 
+void MainWindow::stopReport()
+{
+    if (!m_reportThread) {
+        return;
+    }
+    
+    m_reportThread->quit();
+    m_reportThread->wait();
+    
+    delete m_reportBuilder;
+    m_reportBuilder = nullptr;
+    delete m_reportThread;
+    m_reportThread = nullptr;
+}
+
+void MainWindow::onImportButtonClicked()
+{
+    if (m_importThread || !m_persistence) {
+        return;
+    }
+    
+    QString filePath = QFileDialog::getOpenFileName(this, QString::fromLocal8Bit("导入任务"), QString(),
+                                                    QString::fromLocal8Bit("任务文件 (*.jsonl *.ndjson *.json *.csv)"));
+    if (filePath.isEmpty()) {
+        return;
+    }
+    
+    // 导入直接写表：先把已有修改全部折叠进表，避免日志尾部覆盖导入的数据
+    // 导入完成并重新加载之前，当前看板不再写快照
+    m_boardLoaded = false;
+    ui->importButton->setEnabled(false);
+    statusBar()->showMessage(QString::fromLocal8Bit("正在导入 %1 ...").arg(filePath));
+    saveTasks();
+    afterPersisted(true, [this, filePath]() { startImport(filePath); });
+}
+
+void MainWindow::startImport(const QString &filePath)
+{
+    m_importThread = new QThread(this);
+    m_importer = new TaskImporter(m_repository.databasePath(), filePath);
+    m_importer->moveToThread(m_importThread);
+    connect(m_importThread, &QThread::started, m_importer, &TaskImporter::importFile);
+    connect(m_importer, &TaskImporter::progress, this, [this](int importedCount) {
+        statusBar()->showMessage(QString::fromLocal8Bit("已导入 %1 个任务 ...").arg(importedCount));
+    });
+    connect(m_importer, &TaskImporter::finished, this, &MainWindow::onImportFinished);
+    m_importThread->start();
+}
+
+void MainWindow::onImportFinished(int importedCount, int skippedCount, int dependencyCount, qint64 elapsedMs)
+{
+    if (sender() != m_importer) {
+        return;
+    }
+    stopImport();
+    ui->importButton->setEnabled(true);
+    
+    qDebug() << "Import:" << importedCount << "tasks," << skippedCount << "skipped,"
+             << dependencyCount << "dependencies in" << elapsedMs << "ms";
+    
+    // 重新加载整个看板，布局只在加载结束时进行一次；导入可能带来新的项目
+    saveTasks();
+    refreshProjectList();
+    loadTasks();
+    
+    statusBar()->showMessage(QString::fromLocal8Bit("导入完成：%1 个任务，跳过 %2 行，%3 条依赖，用时 %4 ms")
+                             .arg(importedCount).arg(skippedCount).arg(dependencyCount).arg(elapsedMs), 10000);
+}
+
+void MainWindow::onExportButtonClicked()
+{
+    if (m_exportThread || !m_persistence) {
+        return;
+    }
+    
+    QString filePath = QFileDialog::getSaveFileName(this, QString::fromLocal8Bit("导出任务"), "tasks.ndjson",
+                                                    QString::fromLocal8Bit("NDJSON (*.ndjson);;NDJSON gzip (*.ndjson.gz)"));
+    if (filePath.isEmpty()) {
+        return;
+    }
+    bool compress = filePath.endsWith(".gz", Qt::CaseInsensitive);
+    
+    // 导出读取的是表中的数据，先提交并折叠所有修改
+    ui->exportButton->setEnabled(false);
+    statusBar()->showMessage(QString::fromLocal8Bit("正在导出到 %1 ...").arg(filePath));
+    saveTasks();
+    afterPersisted(true, [this, filePath, compress]() { startExport(filePath, compress); });
+}
+
+void MainWindow::startExport(const QString &filePath, bool compress)
+{
+    m_exportThread = new QThread(this);
+    m_exporter = new TaskExporter(m_repository.databasePath(), filePath, compress);
+    m_exporter->moveToThread(m_exportThread);
+    connect(m_exportThread, &QThread::started, m_exporter, &TaskExporter::exportFile);
+    connect(m_exporter, &TaskExporter::progress, this, [this](int exportedCount) {
+        statusBar()->showMessage(QString::fromLocal8Bit("已导出 %1 个任务 ...").arg(exportedCount));
+    });
+    connect(m_exporter, &TaskExporter::finished, this, &MainWindow::onExportFinished);
+    m_exportThread->start();
+}
+
+void MainWindow::onExportFinished(bool ok, int exportedCount, qint64 bytesWritten, qint64 elapsedMs)
+{
+    if (sender() != m_exporter) {
+        return;
+    }
+    stopExport();
+    ui->exportButton->setEnabled(true);
+    
+    if (!ok) {
+        statusBar()->showMessage(QString::fromLocal8Bit("导出失败"), 10000);
+        return;
+    }
+    
+    double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+    double tasksPerSecond = exportedCount / seconds;
+    double megabytesPerSecond = bytesWritten / (1024.0 * 1024.0) / seconds;
+    qDebug() << "Export:" << exportedCount << "tasks," << bytesWritten << "bytes in" << elapsedMs << "ms,"
+             << tasksPerSecond << "tasks/s," << megabytesPerSecond << "MB/s";
+    statusBar()->showMessage(QString::fromLocal8Bit("导出完成：%1 个任务，%2 MB，用时 %3 ms（%4 任务/秒，%5 MB/秒）")
+                             .arg(exportedCount).arg(bytesWritten / (1024.0 * 1024.0), 0, 'f', 1).arg(elapsedMs)
+                             .arg(tasksPerSecond, 0, 'f', 0).arg(megabytesPerSecond, 0, 'f', 1), 10000);
+}
+
+void MainWindow::stopExport()
+{
+    if (!m_exportThread) {
+        return;
+    }
+    
+    m_exporter->cancel();
+    m_exportThread->quit();
+    m_exportThread->wait();
+    
+    delete m_exporter;
+    m_exporter = nullptr;
+    delete m_exportThread;
+    m_exportThread = nullptr;
+}
+
+void MainWindow::stopImport()
+{
+    if (!m_importThread) {
+        return;
+    }
+    
+    m_importer->cancel();
+    m_importThread->quit();
+    m_importThread->wait();
+    
+    delete m_importer;
+    m_importer = nullptr;
+    delete m_importThread;
+    m_importThread = nullptr;
+}
+
 void MainWindow::setupScene()
 {
     // 设置主窗口背景色
@@ -643,54 +1330,105 @@ void MainWindow::setupScene()
     );
     
     ui->centralWidget->setStyleSheet(bottomStyle);
+    
+    // 卡片的信号在创建时由 connectCardSignals 统一连接
+}
 
-    QList<QGraphicsItem*> items = m_scene->items();
-    for (QGraphicsItem *item : items) {
-        TaskCard *card = dynamic_cast<TaskCard*>(item);
-        if (card) {
-            disconnect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::onCardDoubleClicked);
-            disconnect(card, &TaskCard::cardReleased, this, &MainWindow::updateCardStatusByPosition);
-            connect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::onCardDoubleClicked);
-            connect(card, &TaskCard::cardReleased, this, &MainWindow::updateCardStatusByPosition);
-        }
-    }
-
-    // 连接任务卡片的悬停信号
-    for (TaskCard* card : m_cards) {
-        connect(card, &TaskCard::cardHovered, this, [this, card]() {
-            // 绘制依赖关系线条
-            if (!card->dependencies().isEmpty()) {
-                drawDependencyLines(card);
-            }
-        });
-        
-        // 连接双击信号到详情页面
-        connect(card, &TaskCard::cardDoubleClicked, this, &MainWindow::showTaskDetails);
-    }
+TaskFilter MainWindow::currentFilter() const
+{
+    TaskFilter filter;
+    filter.from = m_startDateEdit->dateTime();
+    filter.to = m_endDateEdit->dateTime();
+    filter.assignee = m_assigneeFilterEdit->text();
+    filter.searchActive = m_searchActive;
+    filter.searchRank = m_searchRank;
+    return filter;
 }
 
 void MainWindow::applyFilters()
 {
-    QDateTime startDate = m_startDateEdit->dateTime();
-    QDateTime endDate = m_endDateEdit->dateTime();
-    QString assigneeFilter = m_assigneeFilterEdit->text().trimmed();
+    m_filterTimer->stop();
+    m_filterWorker->supersede(++m_filterRequest);
+    m_filterPending = false;
+    
+    QSet<TaskId> visible;
+    m_model->filterIndex().evaluate(currentFilter(), m_model->assignees(), visible);
+    applyVisibleSet(visible);
+}
 
-    for (QGraphicsItem *item : m_scene->items()) {
-        TaskCard *card = dynamic_cast<TaskCard*>(item);
-        if (card) {
-            bool dateMatch = true;
-            if (card->deadline().isValid()) {
-                dateMatch = (!startDate.isValid() || card->deadline() >= startDate) && 
-                            (!endDate.isValid() || card->deadline() <= endDate);
-            }
-            
-            bool assigneeMatch = assigneeFilter.isEmpty() || 
-                                 card->assignee().contains(assigneeFilter, Qt::CaseInsensitive);
+void MainWindow::requestFilter()
+{
+    // 索引和名字表都是隐式共享的，交给后台线程的副本只增加引用计数
+    int request = ++m_filterRequest;
+    m_filterWorker->supersede(request);
+    m_filterPending = true;
+    
+    FilterWorker *worker = m_filterWorker;
+    TaskFilterIndex index = m_model->filterIndex();
+    NameTable assignees = m_model->assignees();
+    TaskFilter filter = currentFilter();
+    QMetaObject::invokeMethod(worker, [worker, request, index, assignees, filter]() {
+        worker->evaluate(request, index, assignees, filter);
+    }, Qt::QueuedConnection);
+}
 
-            card->setVisible(dateMatch && assigneeMatch);
+void MainWindow::onFilterReady(int request, const QSet<TaskId> &visible)
+{
+    // 结果返回前又有新的输入或筛选，丢弃
+    if (request != m_filterRequest) {
+        return;
+    }
+    m_filterPending = false;
+    applyVisibleSet(visible);
+}
+
+void MainWindow::applyVisibleSet(const QSet<TaskId> &matches)
+{
+    // 还没有卡片的任务（分批加载中）不计入可见集合，创建卡片时再按当前条件判断
+    QSet<TaskId> visible;
+    visible.reserve(matches.size());
+    for (TaskId id : matches) {
+        if (m_cardSlots.contains(id)) {
+            visible.insert(id);
+        }
+    }
+    
+    // 只切换显隐实际变化的卡片；第一次筛选前所有卡片都可见，只需隐藏不匹配的
+    int firstChanged[3] = { INT_MAX, INT_MAX, INT_MAX };
+    if (m_filterActive) {
+        for (TaskId id : m_visibleIds) {
+            if (!visible.contains(id)) {
+                setCardVisible(cardById(id), false, firstChanged);
+            }
+        }
+        for (TaskId id : visible) {
+            if (!m_visibleIds.contains(id)) {
+                setCardVisible(cardById(id), true, firstChanged);
+            }
+        }
+    } else {
+        for (TaskCard *card : m_cards) {
+            if (!visible.contains(card->id())) {
+                setCardVisible(card, false, firstChanged);
+            }
         }
     }
-    arrangeCards();
+    m_visibleIds = visible;
+    m_filterActive = true;
+    
+    for (int i = 0; i < 3; ++i) {
+        if (m_searchActive && m_searchReordered) {
+            // 搜索时每列按相关度重新排序，不匹配的卡片已隐藏，保持原有相对顺序排在后面
+            QVector<TaskCard*> cards = m_columns[i].cards();
+            std::stable_sort(cards.begin(), cards.end(), [this](TaskCard *a, TaskCard *b) {
+                return m_searchRank.value(a->id(), INT_MAX) < m_searchRank.value(b->id(), INT_MAX);
+            });
+            m_columns[i].reset(cards);
+        } else if (firstChanged[i] != INT_MAX) {
+            m_columns[i].relayout(firstChanged[i]);
+        }
+    }
+    m_searchReordered = false;
 }
 
 void MainWindow::onFilterButtonClicked()
@@ -698,20 +1436,84 @@ void MainWindow::onFilterButtonClicked()
     applyFilters();
 }
 
+void MainWindow::onSearchTriggered()
+{
+    QString text = ui->searchEdit->text().trimmed();
+    // 新的搜索或清空搜索都作废尚未返回的结果；新结果返回前沿用上一次的结果
+    int request = ++m_searchRequest;
+    
+    if (!text.isEmpty() && m_persistence) {
+        // 搜索走数据库的全文索引：未保存的修改先提交，持久化线程按顺序写入并折叠后再查询
+        saveTasks();
+        statusBar()->showMessage(QString::fromLocal8Bit("正在搜索 ..."));
+        PersistenceWorker *worker = m_persistence;
+        QMetaObject::invokeMethod(m_persistence, [worker, request, text]() {
+            worker->search(request, text, SEARCH_LIMIT);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    
+    m_searchActive = false;
+    m_searchReordered = false;
+    m_searchRank.clear();
+    applyFilters();
+}
+
+void MainWindow::onSearchFinished(int request, const QVector<TaskId> &ids, int totalCount, qint64 elapsedMs)
+{
+    if (request != m_searchRequest) {
+        return;
+    }
+    
+    m_searchActive = true;
+    m_searchReordered = true;
+    m_searchRank.clear();
+    for (int i = 0; i < ids.size(); ++i) {
+        m_searchRank.insert(ids.at(i), i);
+    }
+    // 只显示相关度最高的前 SEARCH_LIMIT 个，被截断时明确告诉用户总数，而不是当作全部结果
+    if (totalCount > ids.size()) {
+        statusBar()->showMessage(QString::fromLocal8Bit("只显示相关度最高的前 %1 个，共 %2 个匹配任务，用时 %3 ms，请缩小搜索范围")
+                                 .arg(ids.size()).arg(totalCount).arg(elapsedMs));
+    } else {
+        statusBar()->showMessage(QString::fromLocal8Bit("找到 %1 个匹配任务，用时 %2 ms").arg(ids.size()).arg(elapsedMs), 10000);
+    }
+    applyFilters();
+}
+
 void MainWindow::onClearFilterButtonClicked()
 {
     m_startDateEdit->setDateTime(QDateTime::currentDateTime().addMonths(-1));
     m_endDateEdit->setDateTime(QDateTime::currentDateTime().addMonths(1));
     m_assigneeFilterEdit->clear();
-    
-    for (QGraphicsItem *item : m_scene->items()) {
-         TaskCard *card = dynamic_cast<TaskCard*>(item);
-         if (card) {
-             card->setVisible(true);
-         }
-     }
-    
-    arrangeCards();
+    ui->searchEdit->blockSignals(true);
+    ui->searchEdit->clear();
+    ui->searchEdit->blockSignals(false);
+    m_searchActive = false;
+    m_searchRank.clear();
+    ++m_searchRequest;
+    
+    // 重置输入框触发的延迟筛选和正在后台进行的筛选都作废
+    m_filterTimer->stop();
+    m_filterWorker->supersede(++m_filterRequest);
+    m_filterPending = false;
+    
+    // 只有筛选生效时才有隐藏的卡片
+    int firstChanged[3] = { INT_MAX, INT_MAX, INT_MAX };
+    if (m_filterActive) {
+        for (TaskCard *card : m_cards) {
+            if (!m_visibleIds.contains(card->id())) {
+                setCardVisible(card, true, firstChanged);
+            }
+        }
+    }
+    m_visibleIds.clear();
+    m_filterActive = false;
+    for (int i = 0; i < 3; ++i) {
+        if (firstChanged[i] != INT_MAX) {
+            m_columns[i].relayout(firstChanged[i]);
+        }
+    }
 }
 
 void MainWindow::setupZoomControls()
@@ -753,6 +1555,164 @@ void MainWindow::setupZoomControls()
     zoomToolBar->addAction(resetZoomAction);
 }
 
+void MainWindow::setupProjectSwitcher()
+{
+    QToolBar *projectToolBar = new QToolBar(QString::fromLocal8Bit("项目"), this);
+    addToolBar(Qt::TopToolBarArea, projectToolBar);
+    
+    projectToolBar->addWidget(new QLabel(QString::fromLocal8Bit("项目："), this));
+    m_projectCombo = new QComboBox(this);
+    m_projectCombo->setMinimumWidth(160);
+    m_projectCombo->setToolTip(QString::fromLocal8Bit("只加载所选项目的任务"));
+    projectToolBar->addWidget(m_projectCombo);
+    
+    connect(m_projectCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onProjectChanged);
+}
+
+void MainWindow::setupBulkActions()
+{
+    // 作用于场景中选中的全部卡片（Ctrl+单击多选）
+    QToolBar *bulkToolBar = new QToolBar(QString::fromLocal8Bit("批量操作"), this);
+    addToolBar(Qt::TopToolBarArea, bulkToolBar);
+    
+    const QString columnNames[3] = {
+        QString::fromLocal8Bit("移到待办"),
+        QString::fromLocal8Bit("移到进行中"),
+        QString::fromLocal8Bit("移到已完成")
+    };
+    for (int status = 0; status < 3; ++status) {
+        QAction *moveAction = new QAction(columnNames[status], this);
+        connect(moveAction, &QAction::triggered, this, [this, status]() {
+            bulkMoveToColumn(status);
+        });
+        bulkToolBar->addAction(moveAction);
+    }
+    bulkToolBar->addSeparator();
+    
+    QAction *assigneeAction = new QAction(QString::fromLocal8Bit("设置负责人"), this);
+    connect(assigneeAction, &QAction::triggered, this, [this]() {
+        if (selectedCards().isEmpty()) {
+            return;
+        }
+        bool ok = false;
+        QString assignee = QInputDialog::getText(this, QString::fromLocal8Bit("设置负责人"),
+                                                 QString::fromLocal8Bit("负责人："), QLineEdit::Normal,
+                                                 QString(), &ok);
+        if (ok) {
+            TaskRecord values;
+            values.assignee = assignee.trimmed();
+            bulkUpdate(values, TaskRecord::DirtyAssignee);
+        }
+    });
+    bulkToolBar->addAction(assigneeAction);
+    
+    QAction *priorityAction = new QAction(QString::fromLocal8Bit("设置优先级"), this);
+    connect(priorityAction, &QAction::triggered, this, [this]() {
+        if (selectedCards().isEmpty()) {
+            return;
+        }
+        QStringList priorities;
+        priorities << QString::fromLocal8Bit("低") << QString::fromLocal8Bit("中") << QString::fromLocal8Bit("高");
+        bool ok = false;
+        QString priority = QInputDialog::getItem(this, QString::fromLocal8Bit("设置优先级"),
+                                                 QString::fromLocal8Bit("优先级："), priorities, 1, false, &ok);
+        if (ok) {
+            TaskRecord values;
+            values.priority = priorities.indexOf(priority);
+            bulkUpdate(values, TaskRecord::DirtyPriority);
+        }
+    });
+    bulkToolBar->addAction(priorityAction);
+    
+    QAction *progressAction = new QAction(QString::fromLocal8Bit("设置进度"), this);
+    connect(progressAction, &QAction::triggered, this, [this]() {
+        if (selectedCards().isEmpty()) {
+            return;
+        }
+        bool ok = false;
+        int progress = QInputDialog::getInt(this, QString::fromLocal8Bit("设置进度"),
+                                            QString::fromLocal8Bit("进度（%）："), 0, 0, 100, 10, &ok);
+        if (ok) {
+            TaskRecord values;
+            values.progress = progress;
+            bulkUpdate(values, TaskRecord::DirtyProgress);
+        }
+    });
+    bulkToolBar->addAction(progressAction);
+    bulkToolBar->addSeparator();
+    
+    QAction *deleteAction = new QAction(QString::fromLocal8Bit("删除所选"), this);
+    deleteAction->setIcon(QIcon::fromTheme("edit-delete"));
+    connect(deleteAction, &QAction::triggered, this, &MainWindow::bulkDelete);
+    bulkToolBar->addAction(deleteAction);
+}
+
+void MainWindow::refreshProjectList()
+{
+    if (!m_projectCombo || !m_repository.isOpen()) {
+        return;
+    }
+    
+    QVector<QPair<QString, int>> projects;
+    m_repository.loadProjects(projects);
+    
+    // 重新填充时保持当前选择，不触发重新加载
+    m_projectCombo->blockSignals(true);
+    m_projectCombo->clear();
+    m_projectCombo->addItem(QString::fromLocal8Bit("全部项目"));
+    int currentIndex = 0;
+    for (const auto &project : projects) {
+        QString name = project.first.isEmpty() ? QString::fromLocal8Bit("未分配项目") : project.first;
+        m_projectCombo->addItem(QString("%1 (%2)").arg(name).arg(project.second), project.first);
+        if (m_projectFiltered && project.first == m_activeProject) {
+            currentIndex = m_projectCombo->count() - 1;
+        }
+    }
+    if (m_projectFiltered && currentIndex == 0) {
+        // 当前项目还没有写入数据库的任务，仍保留在列表中
+        QString name = m_activeProject.isEmpty() ? QString::fromLocal8Bit("未分配项目") : m_activeProject;
+        m_projectCombo->addItem(QString("%1 (0)").arg(name), m_activeProject);
+        currentIndex = m_projectCombo->count() - 1;
+    }
+    m_projectCombo->setCurrentIndex(currentIndex);
+    m_projectCombo->blockSignals(false);
+}
+
+void MainWindow::onProjectChanged(int index)
+{
+    if (index < 0) {
+        return;
+    }
+    
+    // 离开整板视图前刷新快照，下次回到整板时仍可直接映射
+    saveTasks();
+    if (!m_projectFiltered && m_boardLoaded && m_snapshotStale) {
+        writeSnapshot();
+    }
+    
+    QVariant data = m_projectCombo->itemData(index);
+    m_projectFiltered = data.isValid();
+    m_activeProject = data.toString();
+    
+    // 搜索结果按任务ID记录，切换项目后不再适用
+    ui->searchEdit->blockSignals(true);
+    ui->searchEdit->clear();
+    ui->searchEdit->blockSignals(false);
+    m_searchActive = false;
+    m_searchRank.clear();
+    ++m_searchRequest;
+    loadTasks();
+}
+
+QString MainWindow::dependencyLabel(const TaskRecord &dependency) const
+{
+    if (!dependency.stub) {
+        return dependency.title;
+    }
+    QString project = dependency.projectId.isEmpty() ? QString::fromLocal8Bit("未分配项目") : dependency.projectId;
+    return QString::fromLocal8Bit("%1 [项目：%2]").arg(dependency.title, project);
+}
+
 void MainWindow::zoomIn()
 {
     if (m_zoomFactor < MAX_ZOOM) {
@@ -849,6 +1809,34 @@ void MainWindow::showTaskDetails(TaskCard* card)
         layout->addWidget(assigneeLabel);
     }
     
+    // 排期：按依赖链估算的最早完成时间和不耽误截止日期的最晚完成时间
+    if (const TaskTiming *timing = card->timing()) {
+        QString scheduleText = QString::fromLocal8Bit("最早完成: %1")
+            .arg(QDateTime::fromSecsSinceEpoch(timing->earliestFinish).toString("yyyy-MM-dd hh:mm"));
+        if (timing->constrained()) {
+            scheduleText += QString::fromLocal8Bit(" | 最晚完成: %1 | 余量: %2 小时")
+                .arg(QDateTime::fromSecsSinceEpoch(timing->latestFinish).toString("yyyy-MM-dd hh:mm"))
+                .arg(timing->slack() / 3600);
+        }
+        QLabel *scheduleLabel = new QLabel(scheduleText, detailsDialog);
+        scheduleLabel->setStyleSheet(timing->critical() ? "color: #ff7878;" : "color: #cccccc;");
+        layout->addWidget(scheduleLabel);
+        
+        const QVector<TaskId> path = m_model->schedule().criticalPath(card->id());
+        if (path.size() > 1) {
+            QStringList titles;
+            for (TaskId pathId : path) {
+                if (const TaskRecord *record = m_model->find(pathId)) {
+                    titles << record->title;
+                }
+            }
+            QLabel *pathLabel = new QLabel(QString::fromLocal8Bit("关键依赖链: %1").arg(titles.join(" -> ")), detailsDialog);
+            pathLabel->setStyleSheet("color: #cccccc;");
+            pathLabel->setWordWrap(true);
+            layout->addWidget(pathLabel);
+        }
+    }
+    
     // 进度
     QLabel *progressLabel = new QLabel(QString::fromLocal8Bit("完成进度: %1%").arg(card->progress()), detailsDialog);
     progressLabel->setStyleSheet("color: #cccccc;");
@@ -866,7 +1854,7 @@ void MainWindow::showTaskDetails(TaskCard* card)
     layout->addWidget(descriptionTitle);
     
     QTextEdit *descriptionEdit = new QTextEdit(detailsDialog);
-    descriptionEdit->setText(card->description());
+    descriptionEdit->setText(descriptionFor(card));
     descriptionEdit->setStyleSheet("background-color: rgba(255, 255, 255, 0.1); color: white; border: 1px solid rgba(255, 255, 255, 0.2);");
     descriptionEdit->setReadOnly(true);
     layout->addWidget(descriptionEdit);
@@ -878,10 +1866,12 @@ void MainWindow::showTaskDetails(TaskCard* card)
     
     QListWidget *depsList = new QListWidget(detailsDialog);
     depsList->setStyleSheet("background-color: rgba(255, 255, 255, 0.1); color: white; border: 1px solid rgba(255, 255, 255, 0.2);");
-    for (const TaskCard* depCard : card->dependencies()) {
-        depsList->addItem(depCard->title());
+    for (TaskId depId : card->dependencyIds()) {
+        if (const TaskRecord *dependency = m_model->find(depId)) {
+            depsList->addItem(dependencyLabel(*dependency));
+        }
     }
-    if (card->dependencies().isEmpty()) {
+    if (depsList->count() == 0) {
         depsList->addItem(QString::fromLocal8Bit("无依赖任务"));
     }
     layout->addWidget(depsList);
@@ -910,10 +1900,16 @@ void MainWindow::showTaskDetails(TaskCard* card)
     connect(closeButton, &QPushButton::clicked, detailsDialog, &QDialog::accept);
     btnLayout->addWidget(closeButton);
     
-    // 更新进度
-    connect(progressSlider, &QSlider::valueChanged, [card, progressLabel](int value) {
-        card->setProgress(value);
+    // 更新进度：拖动过程中只改模型，松开时保存一次；键盘和点击每次只改一步，立即保存
+    connect(progressSlider, &QSlider::valueChanged, [this, card, progressLabel, progressSlider](int value) {
+        m_model->setProgress(card->id(), value);
         progressLabel->setText(QString::fromLocal8Bit("完成进度: %1%").arg(value));
+        if (!progressSlider->isSliderDown()) {
+            saveTasks();
+        }
+    });
+    connect(progressSlider, &QSlider::sliderReleased, this, [this]() {
+        saveTasks();
     });
     
     layout->addLayout(btnLayout);
@@ -926,18 +1922,15 @@ void MainWindow::showTaskDetails(TaskCard* card)
 void MainWindow::drawDependencyLines(TaskCard* card)
 {
     // 清除之前的依赖线
-    QList<QGraphicsItem*> allItems = m_scene->items();
-    for (QGraphicsItem* item : allItems) {
-        if (item->data(0).toString() == "dependency_line") {
-            m_scene->removeItem(item);
-            delete item;
-        }
-    }
+    clearDependencyLines();
     
-    // 为每个依赖绘制一条线
-    for (TaskCard* depCard : card->dependencies()) {
+    // 为每个依赖绘制一条线（其他项目的依赖不在场景中，只在详情中列出）
+    for (TaskId depId : card->dependencyIds()) {
+        TaskCard *depCard = cardById(depId);
+        if (!depCard) {
+            continue;
+        }
         QGraphicsLineItem* line = new QGraphicsLineItem();
-        line->setData(0, "dependency_line");
         
         // 设置线条样式
         QPen pen(QColor(120, 180, 255, 180), 2, Qt::DashLine); // 虚线
@@ -958,9 +1951,9 @@ void MainWindow::drawDependencyLines(TaskCard* card)
         arrowHead << endPoint << arrowP1 << arrowP2;
         
         QGraphicsPolygonItem* arrowItem = m_scene->addPolygon(arrowHead, Qt::NoPen, QBrush(QColor(120, 180, 255, 180)));
-        arrowItem->setData(0, "dependency_line");
         
         m_scene->addItem(line);
+        m_dependencyLines << line << arrowItem;
     }
 }
 
@@ -991,20 +1984,38 @@ void MainWindow::manageDependencies(TaskCard* card)
     taskList->setStyleSheet("background-color: rgba(255, 255, 255, 0.1); color: white; border: 1px solid rgba(255, 255, 255, 0.2);");
     taskList->setSelectionMode(QAbstractItemView::MultiSelection);
     
-    QList<TaskCard*> dependencies = card->dependencies();
+    const QVector<TaskId> dependencies = card->dependencyIds();
+    // 直接或间接依赖当前任务的任务不能再作为它的依赖，否则形成循环
+    QSet<TaskId> blockedIds;
+    for (TaskId blockedId : m_model->dependencyGraph().blockedTasks(card->id())) {
+        blockedIds.insert(blockedId);
+    }
     
     for (TaskCard* otherCard : m_cards) {
         if (otherCard != card) {  // 排除当前任务自身
             QListWidgetItem *item = new QListWidgetItem(otherCard->title(), taskList);
-            item->setData(Qt::UserRole, QVariant::fromValue(otherCard));
+            item->setData(Qt::UserRole, QVariant(otherCard->id()));
             
-            // 如果是已有依赖，则预先选中
-            if (dependencies.contains(otherCard)) {
+            if (blockedIds.contains(otherCard->id())) {
+                item->setFlags(item->flags() & ~(Qt::ItemIsEnabled | Qt::ItemIsSelectable));
+                item->setToolTip(QString::fromLocal8Bit("该任务依赖当前任务，不能再作为它的依赖"));
+            } else if (dependencies.contains(otherCard->id())) {
+                // 如果是已有依赖，则预先选中
                 item->setSelected(true);
             }
         }
     }
     
+    // 其他项目中的已有依赖也列出，否则确定时会被当作取消选择而删除
+    for (TaskId depId : dependencies) {
+        const TaskRecord *dependency = m_model->find(depId);
+        if (dependency && dependency->stub) {
+            QListWidgetItem *item = new QListWidgetItem(dependencyLabel(*dependency), taskList);
+            item->setData(Qt::UserRole, QVariant(depId));
+            item->setSelected(true);
+        }
+    }
+    
     layout->addWidget(taskList);
     
     QLabel *infoLabel = new QLabel(QString::fromLocal8Bit("选择的任务将成为当前任务的依赖项。"));
@@ -1023,17 +2034,25 @@ void MainWindow::manageDependencies(TaskCard* card)
     
     connect(cancelButton, &QPushButton::clicked, depDialog, &QDialog::reject);
     connect(okButton, &QPushButton::clicked, [this, depDialog, taskList, card]() {
-        // 清除现有依赖
-        QList<TaskCard*> oldDependencies = card->dependencies();
-        for (TaskCard* dep : oldDependencies) {
-            card->removeDependency(dep);
-        }
-        
-        // 添加新选择的依赖
+        // 用选中的任务替换现有依赖，模型只为实际增删的边写日志
+        QVector<TaskId> dependencyIds;
         QList<QListWidgetItem*> selectedItems = taskList->selectedItems();
         for (QListWidgetItem* item : selectedItems) {
-            TaskCard* depCard = item->data(Qt::UserRole).value<TaskCard*>();
-            card->addDependency(depCard);
+            dependencyIds.append(item->data(Qt::UserRole).toLongLong());
+        }
+        const QVector<TaskId> rejected = m_model->setDependencies(card->id(), dependencyIds);
+        
+        saveTasks();
+        
+        if (!rejected.isEmpty()) {
+            QStringList titles;
+            for (TaskId depId : rejected) {
+                if (const TaskRecord *dependency = m_model->find(depId)) {
+                    titles << dependency->title;
+                }
+            }
+            QMessageBox::warning(depDialog, QString::fromLocal8Bit("警告"),
+                                 QString::fromLocal8Bit("以下任务会形成循环依赖，未添加：\n%1").arg(titles.join("\n")));
         }
         
         // 更新视图
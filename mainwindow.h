@@ -22,8 +22,25 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QList>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QHash>
+#include <QCache>
+#include <functional>
 #include "taskcard.h"
+#include "taskmodel.h"
+#include "columnlayout.h"
+#include "filterworker.h"
 #include "reportdialog.h"
+#include "persistenceworker.h"
+#include "taskrepository.h"
+#include "taskloader.h"
+#include "taskimporter.h"
+#include "taskexporter.h"
+#include "reportbuilder.h"
 
 class MainWindow : public QMainWindow
 {
@@ -50,13 +67,89 @@ private:
     Ui::MainWindow* ui;
     QGraphicsView *view;
     QGraphicsScene *m_scene;
-    QSqlDatabase m_db;
+    TaskRepository m_repository;
+    
+    // 后台持久化线程
+    QThread *m_persistenceThread;
+    PersistenceWorker *m_persistence;
+    // 等待日志写入/折叠完成后继续的操作，按请求序号在 compacted 信号中取出
+    QHash<int, std::function<void()>> m_afterCompaction;
+    int m_compactTicket;
+    
+    // 任务数据模型，卡片是绑定到其中记录的视图
+    TaskModel *m_model;
     QGraphicsRectItem *todoColumn;
     QGraphicsRectItem *inProgressColumn;
     QGraphicsRectItem *doneColumn;
     
-    // 任务卡片列表
-    QList<TaskCard*> m_cards;
+    // 卡片注册表：紧凑数组供遍历，ID -> 数组下标供按ID查找，所有卡片操作都经过这里而不扫描场景
+    // 删除时把末尾的卡片移到空位，数组中的顺序不代表显示顺序
+    QVector<TaskCard*> m_cards;
+    QHash<TaskId, int> m_cardSlots;
+    QList<QGraphicsItem*> m_dependencyLines;     // 当前显示的依赖线和箭头
+    QVector<TaskId> m_highlightedIds;            // 当前高亮的依赖链上的任务
+    
+    // 每个状态列的显示顺序和累计位置，单张卡片的变化只重排该列中其后的卡片
+    ColumnLayout m_columns[3];
+    
+    // 按项目加载：当前项目之外被依赖的任务只作为占位记录放在模型中，不创建卡片
+    QComboBox *m_projectCombo;
+    bool m_projectFiltered;
+    QString m_activeProject;
+    
+    // 按需加载的完整描述，按字符数计算开销的 LRU 缓存
+    QCache<TaskId, QString> m_descriptionCache;
+    static const int DESCRIPTION_CACHE_CHARS = 1024 * 1024;
+    
+    // 全文搜索结果：任务ID -> 相关度名次
+    QHash<TaskId, int> m_searchRank;
+    bool m_searchActive;
+    bool m_searchReordered;     // 搜索结果变化后下一次筛选按相关度重排各列
+    int m_searchRequest;        // 搜索在持久化线程中进行，只采用最新一次请求的结果
+    
+    // 筛选生效时当前可见的卡片，新的筛选只切换与它不同的卡片
+    QSet<TaskId> m_visibleIds;
+    bool m_filterActive;
+    static const int SEARCH_LIMIT = 5000;
+    
+    // 异步分批加载
+    QThread *m_loaderThread;
+    TaskLoader *m_loader;
+    QQueue<TaskId> m_pendingIds[3];              // 已进入模型、等待创建卡片的任务，按状态列分别排队
+    QTimer *m_loadTimer;
+    QElapsedTimer m_loadClock;
+    bool m_loaderFinished;
+    bool m_loadedFromSnapshot;
+    bool m_boardLoaded;         // 看板已完整加载，可以写快照
+    int m_loadRequest;          // 等待日志写入期间又发起了新的加载时，旧的请求作废
+    bool m_snapshotStale;       // 快照写入后又有新的变更
+    qint64 m_firstCardMs;
+    
+    // 后台批量导入
+    QThread *m_importThread;
+    TaskImporter *m_importer;
+    
+    // 后台导出
+    QThread *m_exportThread;
+    TaskExporter *m_exporter;
+    
+    // 后台生成报表
+    QThread *m_reportThread;
+    ReportBuilder *m_reportBuilder;
+    
+    // 边输入边筛选：输入停顿后在后台线程求可见集合，新的输入作废旧的请求
+    QThread *m_filterThread;
+    FilterWorker *m_filterWorker;
+    QTimer *m_filterTimer;
+    int m_filterRequest;
+    bool m_filterPending;       // 有后台筛选尚未返回；期间修改过的任务要让它作废重算
+    static const int FILTER_DEBOUNCE_MS = 150;
+    
+    // 每个时间片内创建卡片的预算（毫秒），保证界面保持流畅
+    static const int LOAD_SLICE_MS = 8;
+    
+    // 排期基准时间的刷新间隔
+    static const int SCHEDULE_REFRESH_MS = 10 * 60 * 1000;
     
     // 创建任务对话框组件
     QDialog *m_taskDialog;
@@ -82,46 +175,104 @@ private:
     const qreal MAX_ZOOM = 2.0;
     
     void initDatabase();
+    void startPersistence();
+    void stopPersistence();
+    void submitChanges(const QVector<TaskChange> &changes);
     void saveTasks();
+    // 已提交的变更写进日志（fold 时再折叠进表）后在GUI线程调用 next，不阻塞界面
+    void afterPersisted(bool fold, const std::function<void()> &next);
     void loadTasks();
+    void startLoader();
+    void stopLoading();
+    void startImport(const QString &filePath);
+    void stopImport();
+    void startExport(const QString &filePath, bool compress);
+    void stopExport();
+    void startReport();
+    void stopReport();
+    void startFilterWorker();
+    void stopFilterWorker();
+    void processLoadSlice();
+    void finishLoading();
+    void writeSnapshot();
+    TaskCard *createCard(TaskId id);
+    void createLoadedCard(TaskId id);
+    TaskCard *cardById(TaskId id) const;
+    void removeCard(TaskCard *card);
+    void unregisterCard(TaskCard *card);
+    void removeAllCards();
+    void clearDependencyLines();
+    int columnOf(const TaskCard *card) const;
+    void setCardVisible(TaskCard *card, bool visible, int firstChanged[3]);
+    void connectCardSignals(TaskCard *card);
+    QString descriptionFor(TaskCard *card);
     void setupColumns();
     void setupTaskDialog();
     void setupScene();
     void setupZoomControls(); // 添加缩放控制设置
+    void setupProjectSwitcher();
+    void setupBulkActions();
+    void refreshProjectList();
+    QString dependencyLabel(const TaskRecord &dependency) const;
     
     // 创建新任务
     void createNewTask(const QString &title, const QString &description, 
                      TaskCard::Priority priority, TaskCard::Status status, 
                      const QDateTime &deadline, const QString& assignee);
     
-    // 自动排列任务卡片
-    void arrangeCards();
-    
     // 确定任务卡片位置属于哪一列
     TaskCard::Status getStatusFromPosition(qreal x);
 
-    void applyFilters(); // Add filter application method
+    // 立即在界面线程筛选（筛选按钮和搜索），同时作废正在后台进行的筛选
+    void applyFilters();
+    // 输入停顿后把筛选交给后台线程
+    void requestFilter();
+    TaskFilter currentFilter() const;
+    // 只切换与当前可见集合不同的卡片
+    void applyVisibleSet(const QSet<TaskId> &visible);
+    // 卡片新建或截止日期、负责人修改后，按当前条件重新决定它的显隐
+    void refilterCard(TaskCard *card);
+    
+    // 多选批量操作：模型一次批量修改、保存时一个事务、每列只重排一遍
+    QVector<TaskCard*> selectedCards() const;
+    void bulkMoveToColumn(int status);
+    void bulkUpdate(const TaskRecord &values, int fields);
+    void bulkDelete();
     
     // 显示任务详情对话框
     void showTaskDetails(TaskCard* card);
     
     // 绘制依赖关系线条
     void drawDependencyLines(TaskCard* card);
+    // 高亮悬停任务的完整上下游依赖链
+    void highlightDependencyChain(TaskCard *card);
     
     // 管理任务依赖关系
     void manageDependencies(TaskCard* card);
 
 private slots:
+    void onCompacted(int ticket);
+    void onRecordsLoaded(const QVector<TaskRecord> &records);
+    void onLoaderFinished(int taskCount, qint64 readMs, bool fromSnapshot);
     void onAddButtonClicked();
     void onDeleteButtonClicked();
     void onClearButtonClicked();
     void onReportButtonClicked();
+    void onReportReady(const TaskReport &report);
+    void onImportButtonClicked();
+    void onImportFinished(int importedCount, int skippedCount, int dependencyCount, qint64 elapsedMs);
+    void onExportButtonClicked();
+    void onExportFinished(bool ok, int exportedCount, qint64 bytesWritten, qint64 elapsedMs);
     void onTaskDialogAccepted();
     
     // 处理卡片双击事件
     void onCardDoubleClicked(TaskCard *card);
     void onFilterButtonClicked(); // Slot for filter button
+    void onFilterReady(int request, const QSet<TaskId> &visible);
+    void onSearchTriggered();
+    void onSearchFinished(int request, const QVector<TaskId> &ids, int totalCount, qint64 elapsedMs);
     void onClearFilterButtonClicked(); // Slot for clear filter button
+    void onProjectChanged(int index);
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
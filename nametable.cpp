@@ -0,0 +1,64 @@
+﻿#include "nametable.h"
+
+NameTable::NameTable()
+{
+    clear();
+}
+
+int NameTable::size() const
+{
+    return m_names.size();
+}
+
+bool NameTable::contains(int handle) const
+{
+    return handle == 0 || (handle > 0 && handle < m_names.size() && !m_names.at(handle).isNull());
+}
+
+int NameTable::handle(const QString &name) const
+{
+    if (name.isEmpty()) {
+        return 0;
+    }
+    return m_handles.value(name, -1);
+}
+
+QString NameTable::name(int handle) const
+{
+    if (handle < 0 || handle >= m_names.size()) {
+        return QString();
+    }
+    return m_names.at(handle);
+}
+
+int NameTable::intern(const QString &name)
+{
+    int existing = handle(name);
+    if (existing >= 0) {
+        return existing;
+    }
+    
+    int newHandle = m_names.size();
+    m_names.append(name);
+    m_handles.insert(name, newHandle);
+    return newHandle;
+}
+
+void NameTable::insert(int handle, const QString &name)
+{
+    if (handle <= 0 || name.isEmpty()) {
+        return;
+    }
+    if (handle >= m_names.size()) {
+        m_names.resize(handle + 1);
+    }
+    m_names[handle] = name;
+    m_handles.insert(name, handle);
+}
+
+void NameTable::clear()
+{
+    m_names.clear();
+    m_handles.clear();
+    m_names.append(QString(""));    // 句柄 0：非 null 的空串
+}
@@ -0,0 +1,35 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+// 字符串驻留表：每个不同的名字只保存一份，用小整数句柄引用
+// 句柄 0 固定表示空串（未分配），句柄一经分配不再改变
+// 数据库连接用它缓存查找表（句柄即表中的 id），任务模型用它给记录分配本地句柄
+class NameTable
+{
+public:
+    NameTable();
+
+    int size() const;
+    bool contains(int handle) const;
+    // 不存在时返回 -1
+    int handle(const QString &name) const;
+    // 不存在时返回空串；返回的 QString 与表中共享同一份数据
+    QString name(int handle) const;
+
+    // 取名字的句柄，不存在时分配下一个句柄
+    int intern(const QString &name);
+    // 按外部给定的句柄装入（数据库查找表的 id），中间空缺的句柄保持为空
+    void insert(int handle, const QString &name);
+    // 只保留句柄 0
+    void clear();
+
+private:
+    QVector<QString> m_names;
+    QHash<QString, int> m_handles;
+};
+
+#endif // NAMETABLE_H
@@ -0,0 +1,167 @@
+﻿#include "persistenceworker.h"
+#include "taskjournal.h"
+#include "boardsnapshot.h"
+#include <QElapsedTimer>
+#include <QSqlError>
+#include <QDebug>
+
+PersistenceWorker::PersistenceWorker(const QString &databasePath, QObject *parent)
+    : QObject(parent),
+      m_databasePath(databasePath),
+      m_repository("persistence"),
+      m_compactTimer(new QTimer(this)),
+      m_uncompactedCount(0)
+{
+    // 计时器作为子对象，随 moveToThread 一起移到工作线程
+    m_compactTimer->setSingleShot(true);
+    m_compactTimer->setInterval(COMPACT_INTERVAL_MS);
+    connect(m_compactTimer, &QTimer::timeout, this, &PersistenceWorker::compact);
+}
+
+PersistenceWorker::~PersistenceWorker()
+{
+}
+
+void PersistenceWorker::open()
+{
+    if (!m_repository.open(m_databasePath)) {
+        return;
+    }
+    
+    // 上次异常退出留下的日志由加载线程在内存中重放，这里稍后在后台折叠
+    m_compactTimer->start();
+}
+
+void PersistenceWorker::enqueue(const QVector<TaskChange> &changes)
+{
+    m_backlog += changes;
+    if (!appendBacklog()) {
+        return;
+    }
+    
+    m_uncompactedCount += changes.size();
+    if (m_uncompactedCount >= COMPACT_THRESHOLD) {
+        compact();
+    } else if (!m_compactTimer->isActive()) {
+        m_compactTimer->start();
+    }
+}
+
+bool PersistenceWorker::appendBacklog()
+{
+    if (m_backlog.isEmpty()) {
+        return true;
+    }
+    
+    if (!m_repository.isOpen()) {
+        qDebug() << "Persistence: database is not open, cannot save tasks.";
+        return false;
+    }
+    
+    // 同一批变更作为一次小追加提交
+    if (!m_repository.transaction()) {
+        qDebug() << "Persistence: cannot begin transaction:" << m_repository.database().lastError().text();
+        return false;
+    }
+    
+    if (!TaskJournal::append(m_repository, m_backlog) || !m_repository.commit()) {
+        qDebug() << "Persistence: journal append failed, will retry:" << m_repository.database().lastError().text();
+        m_repository.rollback();
+        m_compactTimer->start();
+        return false;
+    }
+    
+    int changeCount = m_backlog.size();
+    m_backlog.clear();
+    emit committed(changeCount);
+    return true;
+}
+
+void PersistenceWorker::flush()
+{
+    // 变更到达时已立即写入日志，这里只需重试之前失败的追加
+    appendBacklog();
+}
+
+void PersistenceWorker::compact()
+{
+    foldJournal();
+}
+
+void PersistenceWorker::requestCompaction(int ticket, bool fold)
+{
+    if (fold) {
+        foldJournal();
+    } else {
+        appendBacklog();
+    }
+    // 失败时也要通知，调用方照常继续（读到的只是稍旧的表），失败的部分由计时器重试
+    emit compacted(ticket);
+}
+
+void PersistenceWorker::search(int request, const QString &text, int limit)
+{
+    QElapsedTimer timer;
+    timer.start();
+    foldJournal();
+    
+    QVector<TaskId> ids;
+    int totalCount = 0;
+    if (m_repository.isOpen()) {
+        m_repository.search(text, ids, limit, &totalCount);
+    }
+    emit searchFinished(request, ids, totalCount, timer.elapsed());
+}
+
+bool PersistenceWorker::foldJournal()
+{
+    m_compactTimer->stop();
+    
+    if (!appendBacklog()) {
+        return false;
+    }
+    
+    if (!m_repository.isOpen()) {
+        return false;
+    }
+    
+    int folded = 0;
+    m_repository.resetStatistics();
+    if (TaskJournal::compact(m_repository, &folded)) {
+        m_uncompactedCount = 0;
+        if (folded > 0) {
+            qDebug() << "Persistence: compacted" << folded << "journal entries in"
+                     << m_repository.databaseTimeNs() / 1000 << "us of database time,"
+                     << m_repository.executionCount() << "statements executed";
+        }
+        return true;
+    }
+    m_compactTimer->start();
+    return false;
+}
+
+void PersistenceWorker::writeSnapshot(const QVector<TaskRecord> &records)
+{
+    // 先把积压的变更写进日志，快照的序号才能与记录内容对应
+    if (!appendBacklog()) {
+        return;
+    }
+    
+    if (!m_repository.isOpen()) {
+        return;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase db = m_repository.database();
+    qint64 changeCounter = TaskJournal::lastSequence(db);
+    if (BoardSnapshot::write(BoardSnapshot::pathForDatabase(m_databasePath), records, changeCounter)) {
+        qDebug() << "Persistence: wrote snapshot of" << records.size() << "tasks in" << timer.elapsed() << "ms";
+    }
+}
+
+void PersistenceWorker::close()
+{
+    compact();
+    m_repository.close();
+}
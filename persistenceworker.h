@@ -0,0 +1,60 @@
+#ifndef PERSISTENCEWORKER_H
+#define PERSISTENCEWORKER_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QTimer>
+#include "taskrecord.h"
+#include "taskrepository.h"
+
+// 后台持久化线程：拥有独立的数据库连接
+// 每条变更立即追加到操作日志，再由后台压缩批量折叠进 tasks 表
+class PersistenceWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PersistenceWorker(const QString &databasePath, QObject *parent = nullptr);
+    ~PersistenceWorker();
+
+public slots:
+    // 以下槽函数都在工作线程中执行
+    void open();
+    void enqueue(const QVector<TaskChange> &changes);
+    void flush();
+    void compact();
+    // 把积压的变更写进日志，fold 为 true 时再折叠进表，完成后发出 compacted(ticket)
+    // GUI线程在信号中继续后续操作，不阻塞等待数据库
+    void requestCompaction(int ticket, bool fold);
+    // 全文搜索读的是表：先折叠此前提交的变更再查询，结果经 searchFinished 交回GUI线程
+    void search(int request, const QString &text, int limit);
+    void close();
+
+    // 把当前看板写成二进制快照，打上写入时刻的日志序号
+    void writeSnapshot(const QVector<TaskRecord> &records);
+
+signals:
+    void committed(int changeCount);
+    void compacted(int ticket);
+    // ids 最多 limit 个，totalCount 是全部匹配数
+    void searchFinished(int request, const QVector<TaskId> &ids, int totalCount, qint64 elapsedMs);
+
+private:
+    bool appendBacklog();
+    bool foldJournal();
+
+    QString m_databasePath;
+    TaskRepository m_repository;
+    QTimer *m_compactTimer;
+
+    // 追加失败时暂存，下次写入时重试
+    QVector<TaskChange> m_backlog;
+    int m_uncompactedCount;
+
+    // 日志条数达到阈值或空闲一段时间后触发压缩
+    static const int COMPACT_INTERVAL_MS = 2000;
+    static const int COMPACT_THRESHOLD = 1000;
+};
+
+#endif // PERSISTENCEWORKER_H
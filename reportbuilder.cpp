@@ -0,0 +1,108 @@
+﻿#include "reportbuilder.h"
+#include "taskrepository.h"
+#include <QSqlQuery>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const qint64 MSECS_PER_DAY = 24 * 60 * 60 * 1000;
+
+void sortByCount(QVector<QPair<QString, int>> &counts)
+{
+    std::sort(counts.begin(), counts.end(), [](const QPair<QString, int> &a, const QPair<QString, int> &b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+}
+
+} // namespace
+
+ReportBuilder::ReportBuilder(const QString &databasePath, QObject *parent)
+    : QObject(parent),
+      m_databasePath(databasePath)
+{
+}
+
+void ReportBuilder::build()
+{
+    QElapsedTimer timer;
+    timer.start();
+    TaskReport report;
+    
+    TaskRepository repository("report");
+    if (repository.open(m_databasePath)) {
+        // 同一个读事务中读取，各项统计对应同一时刻
+        repository.transaction();
+        
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const qint64 today = now / MSECS_PER_DAY;
+        
+        // 计数为 0 的桶是触发器留下的，直接忽略
+        QSqlQuery query = repository.statement("SELECT dimension, bucket, task_count FROM task_stats WHERE task_count > 0");
+        if (repository.exec(query)) {
+            while (query.next()) {
+                const QVariant bucket = query.value(1);
+                const int count = query.value(2).toInt();
+                
+                switch (query.value(0).toInt()) {
+                case TaskReport::StatusDimension: {
+                    int status = qBound(0, bucket.toInt(), 2);
+                    report.statusCounts[status] += count;
+                    report.totalCount += count;
+                    break;
+                }
+                case TaskReport::PriorityDimension:
+                    report.priorityCounts[qBound(0, bucket.toInt(), 2)] += count;
+                    break;
+                case TaskReport::AssigneeDimension:
+                    // 桶是查找表引用，名字取自连接的查找表缓存
+                    report.assigneeCounts.append(qMakePair(repository.assigneeName(bucket.toInt()), count));
+                    break;
+                case TaskReport::ProjectDimension:
+                    report.projectCounts.append(qMakePair(repository.projectName(bucket.toInt()), count));
+                    break;
+                case TaskReport::ProgressDimension:
+                    report.progressCounts[qBound(0, bucket.toInt(), TaskReport::PROGRESS_BANDS - 1)] += count;
+                    break;
+                case TaskReport::DeadlineDimension:
+                    if (bucket.type() == QVariant::String) {
+                        if (bucket.toString() == "done") {
+                            report.doneCount += count;
+                        } else {
+                            report.noDeadlineCount += count;
+                        }
+                    } else if (bucket.toLongLong() < today) {
+                        report.overdueCount += count;
+                    } else {
+                        report.upcomingCount += count;
+                    }
+                    break;
+                }
+            }
+            query.finish();
+        }
+        
+        // 今天到期的任务按天分桶分不出是否已过时刻，只对这一天走截止日期索引精确计数
+        QSqlQuery dueToday = repository.statement("SELECT COUNT(*) FROM tasks WHERE deadline >= ? AND deadline < ? AND status <> 2");
+        dueToday.bindValue(0, today * MSECS_PER_DAY);
+        dueToday.bindValue(1, now);
+        if (repository.exec(dueToday) && dueToday.next()) {
+            int overdueToday = dueToday.value(0).toInt();
+            report.overdueCount += overdueToday;
+            report.upcomingCount -= overdueToday;
+        }
+        dueToday.finish();
+        
+        repository.commit();
+    }
+    repository.close();
+    
+    sortByCount(report.assigneeCounts);
+    sortByCount(report.projectCounts);
+    
+    report.elapsedMs = timer.elapsed();
+    qDebug() << "Report: built from summary table in" << report.elapsedMs << "ms," << report.totalCount << "tasks";
+    emit finished(report);
+}
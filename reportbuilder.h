@@ -0,0 +1,61 @@
+#ifndef REPORTBUILDER_H
+#define REPORTBUILDER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QMetaType>
+
+// 报表所需的全部统计数字，由后台线程从汇总表读出后整体交给GUI线程
+struct TaskReport
+{
+    // task_stats.dimension 的取值，写入数据库，只能追加不能修改
+    enum Dimension {
+        StatusDimension   = 1,
+        PriorityDimension = 2,
+        AssigneeDimension = 3,
+        ProjectDimension  = 4,
+        ProgressDimension = 5,   // 进度按 25% 分档，100% 单独一档
+        DeadlineDimension = 6    // 未完成任务按截止日期所在的 UTC 天分桶
+    };
+    static const int PROGRESS_BANDS = 5;
+
+    int totalCount = 0;
+    int statusCounts[3] = { 0, 0, 0 };       // TaskCard::Status
+    int priorityCounts[3] = { 0, 0, 0 };     // TaskCard::Priority
+    int progressCounts[PROGRESS_BANDS] = { 0, 0, 0, 0, 0 };
+    QVector<QPair<QString, int>> assigneeCounts;    // 按任务数降序，空串表示未分配
+    QVector<QPair<QString, int>> projectCounts;     // 按任务数降序，空串表示未分配项目
+
+    // 截止日期状态
+    int overdueCount = 0;
+    int upcomingCount = 0;
+    int noDeadlineCount = 0;
+    int doneCount = 0;
+
+    qint64 elapsedMs = 0;
+};
+
+Q_DECLARE_METATYPE(TaskReport)
+
+// 后台生成报表：在独立连接上读取触发器维护的汇总表
+// 汇总表的行数只与状态、负责人、项目和截止日期的取值个数有关，与任务总数无关
+class ReportBuilder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReportBuilder(const QString &databasePath, QObject *parent = nullptr);
+
+public slots:
+    void build();
+
+signals:
+    void finished(const TaskReport &report);
+
+private:
+    QString m_databasePath;
+};
+
+#endif // REPORTBUILDER_H
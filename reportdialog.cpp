@@ -1,6 +1,8 @@
 ﻿#include "reportdialog.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QGridLayout>
+#include <QLabel>
 #include <QPushButton>
 #include <QFileDialog>
 #include <QPdfWriter>
@@ -8,28 +10,54 @@
 #include <QMessageBox>
 #include <QDebug>
 
-ReportDialog::ReportDialog(const QList<TaskCard*> &cards, QWidget *parent)
+ReportDialog::ReportDialog(const TaskReport &report, QWidget *parent)
     : QDialog(parent),
       m_statusChartView(nullptr),
       m_priorityChartView(nullptr),
-      m_cardsData(cards)
+      m_deadlineChartView(nullptr),
+      m_progressChartView(nullptr),
+      m_assigneeChartView(nullptr),
+      m_projectChartView(nullptr),
+      m_report(report)
 {
     setWindowTitle(QString::fromLocal8Bit("任务报表"));
-    setMinimumSize(800, 600);
+    setMinimumSize(1000, 800);
 
-    // 计算状态和优先级统计
+    // 统计数字已由后台线程从汇总表读出，这里只负责绘图
     QMap<TaskCard::Status, int> statusCounts;
     QMap<TaskCard::Priority, int> priorityCounts;
-    for (const auto &card : m_cardsData) {
-        if (card) { // 确保卡片指针有效
-            statusCounts[card->status()]++;
-            priorityCounts[card->priority()]++;
-        }
+    for (int i = 0; i < 3; ++i) {
+        statusCounts[static_cast<TaskCard::Status>(i)] = m_report.statusCounts[i];
+        priorityCounts[static_cast<TaskCard::Priority>(i)] = m_report.priorityCounts[i];
     }
 
     setupUi();
     createStatusChart(statusCounts);
     createPriorityChart(priorityCounts);
+    createDeadlineChart();
+
+    const char *bandNames[TaskReport::PROGRESS_BANDS] = { "0-24%", "25-49%", "50-74%", "75-99%", "100%" };
+    QVector<QPair<QString, int>> progressCounts;
+    for (int i = 0; i < TaskReport::PROGRESS_BANDS; ++i) {
+        progressCounts.append(qMakePair(QString(bandNames[i]), m_report.progressCounts[i]));
+    }
+    createCountChart(m_progressChartView, QString::fromLocal8Bit("任务进度分布"), progressCounts);
+
+    QVector<QPair<QString, int>> assigneeCounts = m_report.assigneeCounts;
+    for (auto &entry : assigneeCounts) {
+        if (entry.first.isEmpty()) {
+            entry.first = QString::fromLocal8Bit("未分配");
+        }
+    }
+    createCountChart(m_assigneeChartView, QString::fromLocal8Bit("按负责人统计"), assigneeCounts);
+
+    QVector<QPair<QString, int>> projectCounts = m_report.projectCounts;
+    for (auto &entry : projectCounts) {
+        if (entry.first.isEmpty()) {
+            entry.first = QString::fromLocal8Bit("未分配项目");
+        }
+    }
+    createCountChart(m_projectChartView, QString::fromLocal8Bit("按项目统计"), projectCounts);
 }
 
 ReportDialog::~ReportDialog()
@@ -40,17 +68,22 @@ ReportDialog::~ReportDialog()
 void ReportDialog::setupUi()
 {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
-    QHBoxLayout *chartLayout = new QHBoxLayout();
-
-    // 创建状态图表视图
-    m_statusChartView = new QChartView();
-    m_statusChartView->setRenderHint(QPainter::Antialiasing);
-    chartLayout->addWidget(m_statusChartView);
-
-    // 创建优先级图表视图
-    m_priorityChartView = new QChartView();
-    m_priorityChartView->setRenderHint(QPainter::Antialiasing);
-    chartLayout->addWidget(m_priorityChartView);
+    
+    QLabel *summaryLabel = new QLabel(QString::fromLocal8Bit("共 %1 个任务，其中 %2 个已逾期（统计用时 %3 ms）")
+                                      .arg(m_report.totalCount).arg(m_report.overdueCount).arg(m_report.elapsedMs), this);
+    mainLayout->addWidget(summaryLabel);
+    
+    // 三行两列：状态/优先级、截止日期/进度、负责人/项目
+    QGridLayout *chartLayout = new QGridLayout();
+    QChartView **views[] = { &m_statusChartView, &m_priorityChartView, &m_deadlineChartView,
+                             &m_progressChartView, &m_assigneeChartView, &m_projectChartView };
+    for (int i = 0; i < 6; ++i) {
+        QChartView *chartView = new QChartView();
+        chartView->setRenderHint(QPainter::Antialiasing);
+        chartLayout->addWidget(chartView, i / 2, i % 2);
+        *views[i] = chartView;
+        m_chartViews.append(chartView);
+    }
 
     mainLayout->addLayout(chartLayout);
 
@@ -128,6 +161,76 @@ void ReportDialog::createPriorityChart(const QMap<TaskCard::Priority, int> &prio
     m_priorityChartView->setChart(chart);
 }
 
+void ReportDialog::createDeadlineChart()
+{
+    QPieSeries *series = new QPieSeries();
+    series->append(QString::fromLocal8Bit("已逾期"), m_report.overdueCount);
+    series->append(QString::fromLocal8Bit("未到期"), m_report.upcomingCount);
+    series->append(QString::fromLocal8Bit("无截止日期"), m_report.noDeadlineCount);
+    series->append(QString::fromLocal8Bit("已完成"), m_report.doneCount);
+
+    for (auto slice : series->slices()) {
+        slice->setLabelVisible();
+        slice->setLabel(QString("%1 (%2)").arg(slice->label()).arg(slice->value()));
+    }
+    series->slices().first()->setColor(QColor(220, 80, 80));
+
+    QChart *chart = new QChart();
+    chart->addSeries(series);
+    chart->setTitle(QString::fromLocal8Bit("截止日期状态"));
+    chart->legend()->setAlignment(Qt::AlignBottom);
+    chart->setAnimationOptions(QChart::AllAnimations);
+
+    m_deadlineChartView->setChart(chart);
+}
+
+void ReportDialog::createCountChart(QChartView *chartView, const QString &title, const QVector<QPair<QString, int>> &counts)
+{
+    QBarSet *set = new QBarSet(QString::fromLocal8Bit("任务数"));
+    QStringList categories;
+    int otherCount = 0;
+    int maxCount = 0;
+    for (int i = 0; i < counts.size(); ++i) {
+        if (i < MAX_CATEGORIES) {
+            categories << counts.at(i).first;
+            *set << counts.at(i).second;
+            maxCount = qMax(maxCount, counts.at(i).second);
+        } else {
+            otherCount += counts.at(i).second;
+        }
+    }
+    if (otherCount > 0) {
+        categories << QString::fromLocal8Bit("其他");
+        *set << otherCount;
+        maxCount = qMax(maxCount, otherCount);
+    }
+
+    QBarSeries *series = new QBarSeries();
+    series->append(set);
+
+    QChart *chart = new QChart();
+    chart->addSeries(series);
+    chart->setTitle(title);
+    chart->setAnimationOptions(QChart::SeriesAnimations);
+
+    QBarCategoryAxis *axisX = new QBarCategoryAxis();
+    axisX->append(categories);
+    chart->addAxis(axisX, Qt::AlignBottom);
+    series->attachAxis(axisX);
+
+    // 任务数可能很大，刻度数量固定，不随最大值增长
+    QValueAxis *axisY = new QValueAxis();
+    axisY->setRange(0, qMax(1, maxCount));
+    axisY->setTickCount(qMin(6, qMax(2, maxCount + 1)));
+    axisY->setLabelFormat("%d");
+    chart->addAxis(axisY, Qt::AlignLeft);
+    series->attachAxis(axisY);
+
+    chart->legend()->setVisible(false);
+
+    chartView->setChart(chart);
+}
+
 void ReportDialog::saveChartToPdf(QChartView *chartView, const QString &filePath)
 {
     if (!chartView || !chartView->chart()) {
@@ -165,35 +268,30 @@ void ReportDialog::exportToPdf()
     QPainter painter(&pdfWriter);
     painter.setRenderHint(QPainter::Antialiasing);
 
-    // 设置绘制区域
+    // 设置绘制区域，图表按对话框中的布局排成三行两列
     const QRectF pageRect = painter.viewport();
     const qreal titleHeight = 40; // 为标题留出空间
     const qreal chartSpacing = 15; // 图表之间的间距
-    const qreal availableHeight = pageRect.height() - titleHeight - chartSpacing;
-    const qreal chartHeight = availableHeight / 2.0;
-
-    QRectF statusRect(pageRect.left(), pageRect.top() + titleHeight, pageRect.width(), chartHeight);
-    QRectF priorityRect(pageRect.left(), statusRect.bottom() + chartSpacing, pageRect.width(), chartHeight);
+    const int rows = (m_chartViews.size() + 1) / 2;
+    const qreal chartWidth = (pageRect.width() - chartSpacing) / 2.0;
+    const qreal chartHeight = (pageRect.height() - titleHeight - chartSpacing * (rows - 1)) / rows;
 
     // 绘制标题
     painter.setFont(QFont("Arial", 16, QFont::Bold));
     painter.drawText(QRectF(pageRect.left(), pageRect.top(), pageRect.width(), titleHeight), Qt::AlignCenter, QString::fromLocal8Bit("任务管理报表"));
     painter.setFont(QFont()); // 恢复默认字体
 
-    // 绘制状态图表
-    if (m_statusChartView && m_statusChartView->chart()) {
-        m_statusChartView->render(&painter, statusRect, m_statusChartView->rect()); // 绘制到指定区域
-    } else {
-        qWarning() << "Status chart view or chart is null, cannot export.";
-        painter.drawText(statusRect, Qt::AlignCenter, QString::fromLocal8Bit("状态图表无法加载"));
-    }
-
-    // 绘制优先级图表
-    if (m_priorityChartView && m_priorityChartView->chart()) {
-        m_priorityChartView->render(&painter, priorityRect, m_priorityChartView->rect()); // 绘制到指定区域
-    } else {
-        qWarning() << "Priority chart view or chart is null, cannot export.";
-        painter.drawText(priorityRect, Qt::AlignCenter, QString::fromLocal8Bit("优先级图表无法加载"));
+    for (int i = 0; i < m_chartViews.size(); ++i) {
+        QChartView *chartView = m_chartViews.at(i);
+        QRectF chartRect(pageRect.left() + (i % 2) * (chartWidth + chartSpacing),
+                         pageRect.top() + titleHeight + (i / 2) * (chartHeight + chartSpacing),
+                         chartWidth, chartHeight);
+        if (chartView->chart()) {
+            chartView->render(&painter, chartRect, chartView->rect()); // 绘制到指定区域
+        } else {
+            qWarning() << "Chart view" << i << "has no chart, cannot export.";
+            painter.drawText(chartRect, Qt::AlignCenter, QString::fromLocal8Bit("图表无法加载"));
+        }
     }
 
     painter.end();
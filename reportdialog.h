@@ -12,7 +12,9 @@
 #include <QBarCategoryAxis>
 #include <QValueAxis>
 #include "taskcard.h"
+#include "reportbuilder.h"
 #include <QString>
+#include <QList>
 
 QT_CHARTS_USE_NAMESPACE
 
@@ -21,7 +23,7 @@ class ReportDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit ReportDialog(const QList<TaskCard*> &cards, QWidget *parent = nullptr);
+    explicit ReportDialog(const TaskReport &report, QWidget *parent = nullptr);
     ~ReportDialog();
 
 private slots:
@@ -31,11 +33,21 @@ private:
     void setupUi();
     void createStatusChart(const QMap<TaskCard::Status, int> &statusCounts);
     void createPriorityChart(const QMap<TaskCard::Priority, int> &priorityCounts);
+    void createDeadlineChart();
+    // 单组柱状图，条目过多时只显示前 MAX_CATEGORIES 项，其余合并为“其他”
+    void createCountChart(QChartView *chartView, const QString &title, const QVector<QPair<QString, int>> &counts);
     void saveChartToPdf(QChartView *chartView, const QString &filePath);
 
     QChartView *m_statusChartView;
     QChartView *m_priorityChartView;
-    const QList<TaskCard*> &m_cardsData; // 存储任务卡片数据的引用
+    QChartView *m_deadlineChartView;
+    QChartView *m_progressChartView;
+    QChartView *m_assigneeChartView;
+    QChartView *m_projectChartView;
+    QList<QChartView*> m_chartViews;     // 按导出顺序排列
+    TaskReport m_report;
+
+    static const int MAX_CATEGORIES = 10;
 };
 
 #endif // REPORTDIALOG_H 
\ No newline at end of file
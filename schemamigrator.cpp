@@ -0,0 +1,526 @@
+﻿#include "schemamigrator.h"
+#include "taskrecord.h"
+#include "taskjournal.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QVariant>
+#include <QHash>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+
+struct Migration
+{
+    int version;
+    const char *description;
+    bool (*apply)(QSqlDatabase &db);
+};
+
+bool execAll(QSqlDatabase &db, const QStringList &statements)
+{
+    QSqlQuery query(db);
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "Migration statement failed:" << sql << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// v1: 初始表结构（与旧版本的 CREATE TABLE IF NOT EXISTS 相同）
+bool createInitialSchema(QSqlDatabase &db)
+{
+    return execAll(db, {
+        "CREATE TABLE IF NOT EXISTS tasks ("
+        "id TEXT PRIMARY KEY, "
+        "title TEXT, "
+        "description TEXT, "
+        "status INTEGER, "
+        "priority INTEGER, "
+        "deadline TEXT, "
+        "assignee TEXT, "
+        "progress INTEGER, "
+        "project_id TEXT)",
+        "CREATE TABLE IF NOT EXISTS dependencies ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "task_id TEXT, "
+        "dependency_id TEXT)"
+    });
+}
+
+// v2: 依赖关系表以 (task_id, dependency_id) 为主键并去重，反向查询走索引
+bool keyDependencies(QSqlDatabase &db)
+{
+    return execAll(db, {
+        "CREATE TABLE dependencies_v2 ("
+        "task_id TEXT NOT NULL, "
+        "dependency_id TEXT NOT NULL, "
+        "PRIMARY KEY (task_id, dependency_id)) WITHOUT ROWID",
+        "INSERT OR IGNORE INTO dependencies_v2 (task_id, dependency_id) "
+        "SELECT task_id, dependency_id FROM dependencies "
+        "WHERE task_id IS NOT NULL AND dependency_id IS NOT NULL",
+        "DROP TABLE dependencies",
+        "ALTER TABLE dependencies_v2 RENAME TO dependencies",
+        // 主键已覆盖 task_id 前缀查询，这里只需为 dependency_id 建索引
+        "CREATE INDEX IF NOT EXISTS idx_dependencies_dependency ON dependencies(dependency_id)"
+    });
+}
+
+// v3: 截止日期改为 int64 毫秒时间戳，并为常用筛选列建索引
+bool typedDeadlines(QSqlDatabase &db)
+{
+    if (!execAll(db, {
+        "CREATE TABLE tasks_v3 ("
+        "id TEXT PRIMARY KEY, "
+        "title TEXT, "
+        "description TEXT, "
+        "status INTEGER, "
+        "priority INTEGER, "
+        "deadline INTEGER, "
+        "assignee TEXT, "
+        "progress INTEGER, "
+        "project_id TEXT)"
+    })) {
+        return false;
+    }
+    
+    // ISO 字符串按本地时间解析，必须在 Qt 中转换而不能用 SQLite 的 strftime
+    QSqlQuery select(db);
+    if (!select.exec("SELECT id, title, description, status, priority, deadline, assignee, progress, project_id FROM tasks")) {
+        qDebug() << "Migration read failed:" << select.lastError().text();
+        return false;
+    }
+    
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO tasks_v3 (id, title, description, status, priority, deadline, assignee, progress, project_id) "
+                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    
+    while (select.next()) {
+        QString deadlineStr = select.value(5).toString();
+        QDateTime deadline;
+        if (!deadlineStr.isEmpty()) {
+            deadline = QDateTime::fromString(deadlineStr, Qt::ISODate);
+        }
+        
+        insert.addBindValue(select.value(0));
+        insert.addBindValue(select.value(1));
+        insert.addBindValue(select.value(2));
+        insert.addBindValue(select.value(3));
+        insert.addBindValue(select.value(4));
+        insert.addBindValue(deadline.isValid() ? QVariant(deadline.toMSecsSinceEpoch()) : QVariant(QVariant::LongLong));
+        insert.addBindValue(select.value(6));
+        insert.addBindValue(select.value(7));
+        insert.addBindValue(select.value(8));
+        
+        if (!insert.exec()) {
+            qDebug() << "Migration write failed:" << insert.lastError().text();
+            return false;
+        }
+    }
+    select.finish();
+    
+    return execAll(db, {
+        "DROP TABLE tasks",
+        "ALTER TABLE tasks_v3 RENAME TO tasks",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_assignee ON tasks(assignee)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_deadline ON tasks(deadline)"
+    });
+}
+
+// v4: 只追加的操作日志
+bool createOperationLog(QSqlDatabase &db)
+{
+    return execAll(db, {
+        "CREATE TABLE IF NOT EXISTS task_oplog ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "op INTEGER NOT NULL, "
+        "task_id TEXT, "
+        "other_id TEXT, "
+        "payload BLOB)"
+    });
+}
+
+// v5: 新增描述预览列，完整描述移到最后一列
+// 加载时只读取前面的摘要列，SQLite 不必读取长描述占用的溢出页
+bool describePreviews(QSqlDatabase &db)
+{
+    return execAll(db, {
+        "CREATE TABLE tasks_v5 ("
+        "id TEXT PRIMARY KEY, "
+        "title TEXT, "
+        "status INTEGER, "
+        "priority INTEGER, "
+        "deadline INTEGER, "
+        "assignee TEXT, "
+        "progress INTEGER, "
+        "project_id TEXT, "
+        "description_preview TEXT, "
+        "description TEXT)",
+        QString("INSERT INTO tasks_v5 (id, title, status, priority, deadline, assignee, progress, project_id, "
+                "description_preview, description) "
+                "SELECT id, title, status, priority, deadline, assignee, progress, project_id, "
+                "substr(description, 1, %1), description FROM tasks").arg(TaskRecord::PREVIEW_LENGTH),
+        "DROP TABLE tasks",
+        "ALTER TABLE tasks_v5 RENAME TO tasks",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_assignee ON tasks(assignee)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_deadline ON tasks(deadline)"
+    });
+}
+
+// 全文索引的同步触发器，重建 tasks 表后需要重新创建
+QStringList fullTextTriggers()
+{
+    return {
+        "CREATE TRIGGER tasks_fts_insert AFTER INSERT ON tasks BEGIN "
+        "INSERT INTO tasks_fts (rowid, title, description) VALUES (new.rowid, new.title, new.description); "
+        "END",
+        "CREATE TRIGGER tasks_fts_delete AFTER DELETE ON tasks BEGIN "
+        "INSERT INTO tasks_fts (tasks_fts, rowid, title, description) VALUES ('delete', old.rowid, old.title, old.description); "
+        "END",
+        "CREATE TRIGGER tasks_fts_update AFTER UPDATE OF title, description ON tasks BEGIN "
+        "INSERT INTO tasks_fts (tasks_fts, rowid, title, description) VALUES ('delete', old.rowid, old.title, old.description); "
+        "INSERT INTO tasks_fts (rowid, title, description) VALUES (new.rowid, new.title, new.description); "
+        "END"
+    };
+}
+
+// v6: 标题和描述的 FTS5 全文索引，由触发器与 tasks 表保持同步
+// 外部内容表不重复存储文本；SQLite 未编译 FTS5 时跳过，搜索退回 LIKE 查询
+bool createFullTextIndex(QSqlDatabase &db)
+{
+    QSqlQuery probe(db);
+    if (!probe.exec("CREATE VIRTUAL TABLE tasks_fts USING fts5("
+                    "title, description, content='tasks', content_rowid='rowid', tokenize='unicode61')")) {
+        qDebug() << "Migration: FTS5 is not available, full-text search disabled:" << probe.lastError().text();
+        return true;
+    }
+    
+    return execAll(db, fullTextTriggers() << "INSERT INTO tasks_fts (tasks_fts) VALUES ('rebuild')");
+}
+
+// v7: 按项目分区的索引，切换项目时只读取该项目的行
+// 索引按 (project_id, status) 排列，每列的首屏查询和整项目扫描都不需要排序
+bool partitionByProject(QSqlDatabase &db)
+{
+    return execAll(db, {
+        "CREATE INDEX IF NOT EXISTS idx_tasks_project ON tasks(project_id, status)"
+    });
+}
+
+// 汇总表中一行任务对应的各维度桶，row 为 new 或 old，sign 为计数增量
+// 维度编号与 TaskReport::Dimension 一致；负责人和项目的列名随表结构版本变化
+QString statsBuckets(const QString &row, int sign, const QString &assigneeColumn, const QString &projectColumn)
+{
+    return QString("(1, IFNULL(%1.status, 0), %2), "
+                   "(2, IFNULL(%1.priority, 1), %2), "
+                   "(3, IFNULL(%1.%3, ''), %2), "
+                   "(4, IFNULL(%1.%4, ''), %2), "
+                   "(5, min(max(IFNULL(%1.progress, 0), 0) / 25, 4), %2), "
+                   "(6, CASE WHEN %1.status = 2 THEN 'done' WHEN %1.deadline IS NULL THEN '' "
+                   "ELSE %1.deadline / 86400000 END, %2)").arg(row).arg(sign).arg(assigneeColumn, projectColumn);
+}
+
+// 维护汇总表的触发器，重建 tasks 表后需要重新创建
+QStringList statsTriggers(const QString &assigneeColumn, const QString &projectColumn)
+{
+    const QString upsert = " ON CONFLICT(dimension, bucket) DO UPDATE SET task_count = task_count + excluded.task_count;";
+    const QString insert = "INSERT INTO task_stats (dimension, bucket, task_count) VALUES ";
+    
+    return {
+        "CREATE TRIGGER task_stats_insert AFTER INSERT ON tasks BEGIN "
+        + insert + statsBuckets("new", 1, assigneeColumn, projectColumn) + upsert + " END",
+        "CREATE TRIGGER task_stats_delete AFTER DELETE ON tasks BEGIN "
+        + insert + statsBuckets("old", -1, assigneeColumn, projectColumn) + upsert + " END",
+        QString("CREATE TRIGGER task_stats_update AFTER UPDATE OF status, priority, %1, %2, progress, deadline ON tasks BEGIN ")
+        .arg(assigneeColumn, projectColumn)
+        + insert + statsBuckets("old", -1, assigneeColumn, projectColumn) + ", "
+        + statsBuckets("new", 1, assigneeColumn, projectColumn) + upsert + " END"
+    };
+}
+
+// 用已有数据初始化汇总表
+QString statsSeed(const QString &assigneeColumn, const QString &projectColumn)
+{
+    return QString("INSERT INTO task_stats (dimension, bucket, task_count) "
+                "SELECT 1, IFNULL(status, 0), COUNT(*) FROM tasks GROUP BY 2 UNION ALL "
+                "SELECT 2, IFNULL(priority, 1), COUNT(*) FROM tasks GROUP BY 2 UNION ALL "
+                "SELECT 3, IFNULL(%1, ''), COUNT(*) FROM tasks GROUP BY 2 UNION ALL "
+                "SELECT 4, IFNULL(%2, ''), COUNT(*) FROM tasks GROUP BY 2 UNION ALL "
+                "SELECT 5, min(max(IFNULL(progress, 0), 0) / 25, 4), COUNT(*) FROM tasks GROUP BY 2 UNION ALL "
+                "SELECT 6, CASE WHEN status = 2 THEN 'done' WHEN deadline IS NULL THEN '' ELSE deadline / 86400000 END, "
+                "COUNT(*) FROM tasks GROUP BY 2").arg(assigneeColumn, projectColumn);
+}
+
+// v8: 报表汇总表，由触发器随 tasks 的每次写入增量维护
+// 打开报表只读取汇总表，开销与任务总数无关；截止日期按 UTC 天分桶，已完成的任务单独计数
+bool createTaskStatistics(QSqlDatabase &db)
+{
+    // bucket 不声明类型，天数保持整数、其他桶保持文本
+    QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS task_stats ("
+        "dimension INTEGER NOT NULL, "
+        "bucket NOT NULL, "
+        "task_count INTEGER NOT NULL, "
+        "PRIMARY KEY (dimension, bucket)) WITHOUT ROWID"
+    };
+    statements += statsTriggers("assignee", "project_id");
+    statements += statsSeed("assignee", "project_id");
+    return execAll(db, statements);
+}
+
+// v9: 负责人和项目名移到查找表，任务行只保存整数引用（id 0 表示未分配）
+// 几百个名字在十万行中重复出现，精确匹配和分组只需比较整数，名字也只存一份
+// 重建 tasks 表时保留 rowid，外部内容的全文索引不需要重建，只需重新创建触发器
+bool internNames(QSqlDatabase &db)
+{
+    QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS assignees (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE)",
+        "CREATE TABLE IF NOT EXISTS projects (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE)",
+        "INSERT OR IGNORE INTO assignees (id, name) VALUES (0, '')",
+        "INSERT OR IGNORE INTO projects (id, name) VALUES (0, '')",
+        "INSERT OR IGNORE INTO assignees (name) SELECT DISTINCT assignee FROM tasks WHERE assignee IS NOT NULL",
+        "INSERT OR IGNORE INTO projects (name) SELECT DISTINCT project_id FROM tasks WHERE project_id IS NOT NULL",
+        "CREATE TABLE tasks_v9 ("
+        "id TEXT PRIMARY KEY, "
+        "title TEXT, "
+        "status INTEGER, "
+        "priority INTEGER, "
+        "deadline INTEGER, "
+        "assignee_ref INTEGER NOT NULL DEFAULT 0, "
+        "progress INTEGER, "
+        "project_ref INTEGER NOT NULL DEFAULT 0, "
+        "description_preview TEXT, "
+        "description TEXT)",
+        "INSERT INTO tasks_v9 (rowid, id, title, status, priority, deadline, assignee_ref, progress, project_ref, "
+        "description_preview, description) "
+        "SELECT t.rowid, t.id, t.title, t.status, t.priority, t.deadline, IFNULL(a.id, 0), t.progress, IFNULL(p.id, 0), "
+        "t.description_preview, t.description FROM tasks t "
+        "LEFT JOIN assignees a ON a.name = t.assignee "
+        "LEFT JOIN projects p ON p.name = t.project_id",
+        "DROP TABLE tasks",
+        "ALTER TABLE tasks_v9 RENAME TO tasks",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_assignee ON tasks(assignee_ref)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_deadline ON tasks(deadline)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_project ON tasks(project_ref, status)",
+        // 汇总表中负责人和项目的桶改为整数引用
+        "DELETE FROM task_stats"
+    };
+    statements += statsTriggers("assignee_ref", "project_ref");
+    statements += statsSeed("assignee_ref", "project_ref");
+    
+    QSqlQuery probe(db);
+    if (probe.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'tasks_fts'") && probe.next()) {
+        statements += fullTextTriggers();
+    }
+    probe.finish();
+    
+    return execAll(db, statements);
+}
+
+// v10: 任务ID由 UUID 字符串改为 64 位整数，id 列成为 rowid 的别名
+// 已有任务直接用原来的 rowid 作为新ID，全文索引不需要重建；新任务的ID由 TaskRecord::newId() 分配，远大于这些 rowid
+// 依赖表和操作日志中的ID按同一映射改写，日志的 seq 及其自增计数保持不变，快照的变更计数仍然有效
+bool integerIds(QSqlDatabase &db)
+{
+    QHash<QString, TaskId> idMap;
+    TaskId maxId = 0;
+    QSqlQuery select(db);
+    if (!select.exec("SELECT rowid, id FROM tasks")) {
+        qDebug() << "Migration read failed:" << select.lastError().text();
+        return false;
+    }
+    while (select.next()) {
+        TaskId id = select.value(0).toLongLong();
+        idMap.insert(select.value(1).toString(), id);
+        maxId = qMax(maxId, id);
+    }
+    select.finish();
+    
+    // 尚未折叠的日志中新建的任务还不在 tasks 表里，接着分配ID
+    struct OplogRow
+    {
+        qint64 seq;
+        int op;
+        QVariant taskId;
+        QVariant otherId;
+        QByteArray payload;
+    };
+    QVector<OplogRow> oplog;
+    if (!select.exec("SELECT seq, op, task_id, other_id, payload FROM task_oplog ORDER BY seq")) {
+        qDebug() << "Migration read failed:" << select.lastError().text();
+        return false;
+    }
+    while (select.next()) {
+        OplogRow row = { select.value(0).toLongLong(), select.value(1).toInt(),
+                         select.value(2), select.value(3), select.value(4).toByteArray() };
+        if (row.op == TaskChange::Create && !row.taskId.isNull() && !idMap.contains(row.taskId.toString())) {
+            idMap.insert(row.taskId.toString(), ++maxId);
+        }
+        oplog.append(row);
+    }
+    select.finish();
+    
+    qint64 oplogSequence = 0;
+    if (select.exec("SELECT seq FROM sqlite_sequence WHERE name = 'task_oplog'") && select.next()) {
+        oplogSequence = select.value(0).toLongLong();
+    }
+    select.finish();
+    
+    if (!execAll(db, {
+        "CREATE TABLE tasks_v10 ("
+        "id INTEGER PRIMARY KEY, "
+        "title TEXT, "
+        "status INTEGER, "
+        "priority INTEGER, "
+        "deadline INTEGER, "
+        "assignee_ref INTEGER NOT NULL DEFAULT 0, "
+        "progress INTEGER, "
+        "project_ref INTEGER NOT NULL DEFAULT 0, "
+        "description_preview TEXT, "
+        "description TEXT)",
+        "INSERT INTO tasks_v10 (id, title, status, priority, deadline, assignee_ref, progress, project_ref, "
+        "description_preview, description) "
+        "SELECT rowid, title, status, priority, deadline, assignee_ref, progress, project_ref, "
+        "description_preview, description FROM tasks",
+        "CREATE TABLE dependencies_v10 ("
+        "task_id INTEGER NOT NULL, "
+        "dependency_id INTEGER NOT NULL, "
+        "PRIMARY KEY (task_id, dependency_id)) WITHOUT ROWID",
+        "INSERT OR IGNORE INTO dependencies_v10 (task_id, dependency_id) "
+        "SELECT t.rowid, d.rowid FROM dependencies x "
+        "JOIN tasks t ON t.id = x.task_id "
+        "JOIN tasks d ON d.id = x.dependency_id",
+        "CREATE TABLE task_oplog_v10 ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "op INTEGER NOT NULL, "
+        "task_id INTEGER, "
+        "other_id INTEGER, "
+        "payload BLOB)"
+    })) {
+        return false;
+    }
+    
+    // 映射不到的ID属于已删除的任务，对应的日志记录没有意义，直接丢弃
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO task_oplog_v10 (seq, op, task_id, other_id, payload) VALUES (?, ?, ?, ?, ?)");
+    for (const OplogRow &row : oplog) {
+        TaskId taskId = idMap.value(row.taskId.toString());
+        TaskId otherId = idMap.value(row.otherId.toString());
+        if ((!row.taskId.isNull() && taskId == 0) || (!row.otherId.isNull() && otherId == 0)) {
+            continue;
+        }
+        
+        insert.addBindValue(row.seq);
+        insert.addBindValue(row.op);
+        insert.addBindValue(row.taskId.isNull() ? QVariant(QVariant::LongLong) : QVariant(taskId));
+        insert.addBindValue(row.otherId.isNull() ? QVariant(QVariant::LongLong) : QVariant(otherId));
+        insert.addBindValue(row.op == TaskChange::Create ? TaskJournal::upgradeCreatePayload(row.payload, idMap) : row.payload);
+        if (!insert.exec()) {
+            qDebug() << "Migration write failed:" << insert.lastError().text();
+            return false;
+        }
+    }
+    
+    QStringList statements = {
+        "DROP TABLE dependencies",
+        "DROP TABLE tasks",
+        "DROP TABLE task_oplog",
+        "ALTER TABLE tasks_v10 RENAME TO tasks",
+        "ALTER TABLE dependencies_v10 RENAME TO dependencies",
+        "ALTER TABLE task_oplog_v10 RENAME TO task_oplog",
+        // 折叠后日志可能为空，seq 的计数必须沿用旧表的值
+        "DELETE FROM sqlite_sequence WHERE name = 'task_oplog'",
+        QString("INSERT INTO sqlite_sequence (name, seq) "
+                "SELECT 'task_oplog', max(%1, IFNULL((SELECT max(seq) FROM task_oplog), 0))").arg(oplogSequence),
+        "CREATE INDEX IF NOT EXISTS idx_dependencies_dependency ON dependencies(dependency_id)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_assignee ON tasks(assignee_ref)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_deadline ON tasks(deadline)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_project ON tasks(project_ref, status)"
+    };
+    // 任务行没有变化，汇总表保持原样，只需重新创建触发器
+    statements += statsTriggers("assignee_ref", "project_ref");
+    
+    QSqlQuery probe(db);
+    if (probe.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'tasks_fts'") && probe.next()) {
+        statements += fullTextTriggers();
+    }
+    probe.finish();
+    
+    return execAll(db, statements);
+}
+
+const Migration MIGRATIONS[] = {
+    { 1, "initial schema", createInitialSchema },
+    { 2, "keyed and indexed dependencies", keyDependencies },
+    { 3, "epoch deadlines and task indexes", typedDeadlines },
+    { 4, "operation log", createOperationLog },
+    { 5, "description previews", describePreviews },
+    { 6, "full-text index", createFullTextIndex },
+    { 7, "project partitions", partitionByProject },
+    { 8, "report statistics", createTaskStatistics },
+    { 9, "interned assignee and project names", internNames },
+    { 10, "integer task ids", integerIds }
+};
+
+} // namespace
+
+void SchemaMigrator::configureConnection(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    // WAL 模式下读写互不阻塞，提交只需追加日志
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA synchronous = NORMAL");
+}
+
+int SchemaMigrator::currentVersion(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return MIGRATIONS[sizeof(MIGRATIONS) / sizeof(MIGRATIONS[0]) - 1].version;
+}
+
+bool SchemaMigrator::migrate(QSqlDatabase &db)
+{
+    int version = currentVersion(db);
+    
+    for (const Migration &migration : MIGRATIONS) {
+        if (migration.version <= version) {
+            continue;
+        }
+        
+        qDebug() << "Database: migrating to version" << migration.version << "-" << migration.description;
+        
+        if (!db.transaction()) {
+            qDebug() << "Migration error: cannot begin transaction:" << db.lastError().text();
+            return false;
+        }
+        
+        QSqlQuery query(db);
+        bool ok = migration.apply(db)
+                  && query.exec(QString("PRAGMA user_version = %1").arg(migration.version));
+        
+        if (!ok || !db.commit()) {
+            qDebug() << "Migration to version" << migration.version << "failed, rolling back";
+            db.rollback();
+            return false;
+        }
+        
+        version = migration.version;
+    }
+    
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+
+// 基于 PRAGMA user_version 的数据库结构迁移
+// 每个迁移步骤在单独的事务中执行，成功后才递增版本号
+class SchemaMigrator
+{
+public:
+    // 把数据库升级到最新版本，返回是否成功
+    static bool migrate(QSqlDatabase &db);
+
+    // 打开连接后的通用设置（WAL 日志等），每个连接都需要调用
+    static void configureConnection(QSqlDatabase &db);
+
+    static int currentVersion(QSqlDatabase &db);
+    static int latestVersion();
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -6,33 +6,19 @@
 #include <QGraphicsSceneHoverEvent>
 #include <QVBoxLayout>
 #include <QFont>
-#include <QJsonObject>
-#include <QJsonDocument>
-#include <QJsonArray>
+#include "taskjsonwriter.h"
 #include <QTimer>
-#include <QUuid>
 
-TaskCard::TaskCard(const QString &title, const QString &description, 
-                  Priority priority, Status status, const QDateTime &deadline, 
-                  const QString &assignee, const QString &projectId,
-                  QGraphicsItem *parent)
+TaskCard::TaskCard(const TaskModel *model, TaskId id, QGraphicsItem *parent)
     : QGraphicsWidget(parent), 
-      m_title(title), 
-      m_description(description), 
-      m_status(status), 
-      m_priority(priority),
-      m_deadline(deadline),
-      m_assignee(assignee),
-      m_projectId(projectId),
+      m_model(model),
+      m_id(id),
       m_selected(false),
       m_opacity(0.9),
-      m_progress(0), // 初始进度为0
+      m_highlight(NoHighlight),
       m_glowIntensity(0.0),
       m_glowIncreasing(true)
 {
-    // 生成唯一ID
-    m_id = QUuid::createUuid().toString(QUuid::WithoutBraces);
-    
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
     setAcceptHoverEvents(true);
@@ -58,29 +44,33 @@ TaskCard::TaskCard(const QString &title, const QString &description,
     m_glowTimer->start();
 }
 
-// ID相关
-QString TaskCard::id() const
+const TaskRecord &TaskCard::record() const
 {
-    return m_id;
+    static const TaskRecord emptyRecord;
+    const TaskRecord *record = m_model->find(m_id);
+    return record ? *record : emptyRecord;
 }
 
-void TaskCard::setId(const QString &id)
+// ID相关
+TaskId TaskCard::id() const
 {
-    m_id = id;
+    return m_id;
 }
 
-// 项目ID相关
 QString TaskCard::projectId() const
 {
-    return m_projectId;
+    return record().projectId;
 }
 
-void TaskCard::setProjectId(const QString &projectId)
+// 自定义颜色和字体
+void TaskCard::setHighlight(Highlight highlight)
 {
-    m_projectId = projectId;
+    if (m_highlight != highlight) {
+        m_highlight = highlight;
+        update();
+    }
 }
 
-// 自定义颜色和字体
 void TaskCard::setCardColor(const QColor &color)
 {
     m_customColor = color;
@@ -100,37 +90,15 @@ void TaskCard::setTextFont(const QFont &font)
 }
 
 // 进度相关
-void TaskCard::setProgress(int progress)
-{
-    // 确保进度在0-100范围内
-    m_progress = qBound(0, progress, 100);
-    emit progressChanged(this, m_progress);
-    update(); // 更新显示
-}
-
 int TaskCard::progress() const
 {
-    return m_progress;
+    return record().progress;
 }
 
 // 依赖相关
-void TaskCard::addDependency(TaskCard* task)
+QVector<TaskId> TaskCard::dependencyIds() const
 {
-    if (!m_dependencies.contains(task)) {
-        m_dependencies.append(task);
-        update();
-    }
-}
-
-void TaskCard::removeDependency(TaskCard* task)
-{
-    m_dependencies.removeOne(task);
-    update();
-}
-
-QList<TaskCard*> TaskCard::dependencies() const
-{
-    return m_dependencies;
+    return record().dependencyIds;
 }
 
 // 悬停事件处理
@@ -153,7 +121,8 @@ void TaskCard::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
 void TaskCard::drawProgressBar(QPainter *painter, const QRectF &rect)
 {
     // 只有非零进度时才绘制进度条
-    if (m_progress <= 0)
+    const int progress = record().progress;
+    if (progress <= 0)
         return;
         
     const int progressBarHeight = 4;
@@ -166,14 +135,14 @@ void TaskCard::drawProgressBar(QPainter *painter, const QRectF &rect)
     painter->drawRoundedRect(progressRect, 2, 2);
     
     // 绘制进度
-    qreal progressWidth = progressRect.width() * (m_progress / 100.0);
+    qreal progressWidth = progressRect.width() * (progress / 100.0);
     QRectF filledRect(progressRect.left(), progressRect.top(), progressWidth, progressBarHeight);
     
     // 根据进度调整颜色
     QColor progressColor;
-    if (m_progress < 30) {
+    if (progress < 30) {
         progressColor = QColor(255, 100, 100); // 红色
-    } else if (m_progress < 70) {
+    } else if (progress < 70) {
         progressColor = QColor(255, 200, 0);  // 黄色
     } else {
         progressColor = QColor(100, 255, 100); // 绿色
@@ -186,7 +155,7 @@ void TaskCard::drawProgressBar(QPainter *painter, const QRectF &rect)
     painter->setPen(QColor(200, 200, 200));
     QFont percentFont("微软雅黑", 7, QFont::Bold);
     painter->setFont(percentFont);
-    QString percentText = QString::number(m_progress) + "%";
+    QString percentText = QString::number(progress) + "%";
     QRectF percentRect = QRectF(progressRect.right() - 35, progressRect.top() - 12, 30, 10);
     painter->drawText(percentRect, Qt::AlignRight, percentText);
     
@@ -278,10 +247,23 @@ void TaskCard::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
     // 绘制圆角矩形卡片
     painter->drawRoundedRect(rect, 10, 10);
     
-    // 添加白色细边框
-    painter->setPen(QPen(QColor(255, 255, 255, 100), 1));  // 更淡的边框
+    // 添加白色细边框，在关键路径上的未完成任务改用红色边框
+    const TaskTiming *schedule = timing();
+    if (schedule && schedule->critical() && record().status != Done) {
+        painter->setPen(QPen(QColor(255, 90, 90, 200), 2));
+    } else {
+        painter->setPen(QPen(QColor(255, 255, 255, 100), 1));  // 更淡的边框
+    }
     painter->drawRoundedRect(rect, 10, 10);
     
+    // 依赖链高亮：上游为橙色，下游为青色
+    if (m_highlight != NoHighlight) {
+        QColor chainColor = m_highlight == UpstreamHighlight ? QColor(255, 180, 80) : QColor(90, 220, 230);
+        painter->setPen(QPen(chainColor, 3));
+        painter->setBrush(Qt::NoBrush);
+        painter->drawRoundedRect(rect.adjusted(1.5, 1.5, -1.5, -1.5), 10, 10);
+    }
+    
     // 渲染卡片内容
     renderCardContent(painter, rect);
     
@@ -292,44 +274,64 @@ void TaskCard::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 void TaskCard::renderCardContent(QPainter *painter, const QRectF &rect)
 {
     painter->save();
+    const TaskRecord &task = record();
+    
+    // 排期余量显示在标题右侧：负数表示按依赖链估算会错过截止日期
+    QString slackText;
+    const TaskTiming *schedule = timing();
+    if (schedule && schedule->constrained() && task.status != Done) {
+        qint64 slack = schedule->slack();
+        if (slack < 0) {
+            slackText = QString::fromLocal8Bit("延误%1天").arg((-slack + 86399) / 86400);
+        } else {
+            slackText = QString::fromLocal8Bit("余量%1天").arg(slack / 86400);
+        }
+    }
     
     // 绘制标题（发光效果）- 使用自定义字体
-    QRectF titleRect = QRectF(rect.left() + 10, rect.top() + 10, rect.width() - 20, 20);
-    drawGlowingText(painter, titleRect, m_title, m_titleFont, QColor(220, 220, 220), Qt::AlignLeft | Qt::AlignVCenter);
+    qreal slackWidth = slackText.isEmpty() ? 0 : 60;
+    QRectF titleRect = QRectF(rect.left() + 10, rect.top() + 10, rect.width() - 20 - slackWidth, 20);
+    drawGlowingText(painter, titleRect, task.title, m_titleFont, QColor(220, 220, 220), Qt::AlignLeft | Qt::AlignVCenter);
+    if (!slackText.isEmpty()) {
+        QFont slackFont("微软雅黑", 8, QFont::Bold);
+        QColor slackColor = schedule->critical() ? QColor(255, 120, 120) : QColor(150, 220, 150);
+        QRectF slackRect = QRectF(titleRect.right(), rect.top() + 10, slackWidth, 20);
+        drawGlowingText(painter, slackRect, slackText, slackFont, slackColor, Qt::AlignRight | Qt::AlignVCenter);
+    }
     
     // 计算描述文本区域（从标题下方到状态栏上方的空间）
     QRectF descRect = QRectF(rect.left() + 10, rect.top() + 35, rect.width() - 20, rect.height() - 70);
     
     // 使用 drawGlowingText 绘制自动换行的文本
-    QString elidedDesc = painter->fontMetrics().elidedText(m_description, Qt::ElideRight, descRect.width() * 3);
+    QString elidedDesc = painter->fontMetrics().elidedText(task.descriptionPreview, Qt::ElideRight, descRect.width() * 3);
     drawGlowingText(painter, descRect, elidedDesc, m_textFont, QColor(200, 200, 200), 
                    static_cast<Qt::Alignment>(Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap));
     
     // 绘制状态指示器
     QString statusText;
-    switch (m_status) {
+    switch (task.status) {
         case Todo: statusText = QString::fromLocal8Bit("待办"); break;
         case InProgress: statusText = QString::fromLocal8Bit("进行中"); break;
         case Done: statusText = QString::fromLocal8Bit("已完成"); break;
     }
     
     QFont statusFont("微软雅黑", 8, QFont::Bold);
-    qreal statusWidth = m_assignee.isEmpty() ? 60 : 40;
+    qreal statusWidth = task.assignee.isEmpty() ? 60 : 40;
     QRectF statusRect = QRectF(rect.left() + 10, rect.bottom() - 25, statusWidth, 20);
     drawGlowingText(painter, statusRect, statusText, statusFont, QColor(180, 180, 180), Qt::AlignLeft | Qt::AlignVCenter);
 
     // 绘制执行人（发光效果）
-    if (!m_assignee.isEmpty()) {
+    if (!task.assignee.isEmpty()) {
         QFont assigneeFont("微软雅黑", 8, QFont::Bold);
         QRectF assigneeRect = QRectF(statusRect.right() + 5, rect.bottom() - 25, 50, 20);
-        drawGlowingText(painter, assigneeRect, m_assignee, assigneeFont, QColor(200, 200, 200), 
+        drawGlowingText(painter, assigneeRect, task.assignee, assigneeFont, QColor(200, 200, 200), 
                        static_cast<Qt::Alignment>(Qt::AlignLeft | Qt::AlignVCenter));
     }
 
     // 绘制截止日期（发光效果）
-    if (m_deadline.isValid()) {
-        QString dateText = m_deadline.toString("MM-dd");
-        qreal dateX = m_assignee.isEmpty() ? rect.right() - 70 : rect.right() - 60;
+    if (task.deadline.isValid()) {
+        QString dateText = task.deadline.toString("MM-dd");
+        qreal dateX = task.assignee.isEmpty() ? rect.right() - 70 : rect.right() - 60;
         QRectF dateRect = QRectF(dateX, rect.bottom() - 25, 50, 20);
         drawGlowingText(painter, dateRect, dateText, statusFont, QColor(180, 180, 180), 
                        static_cast<Qt::Alignment>(Qt::AlignRight | Qt::AlignVCenter));
@@ -338,9 +340,14 @@ void TaskCard::renderCardContent(QPainter *painter, const QRectF &rect)
     painter->restore();
 }
 
+const TaskTiming *TaskCard::timing() const
+{
+    return m_model->schedule().timing(m_id);
+}
+
 QColor TaskCard::getPriorityColor() const
 {
-    switch (m_priority) {
+    switch (record().priority) {
         case Low:
             return QColor(41, 128, 185);  // 浅蓝色
         case Medium:
@@ -352,59 +359,39 @@ QColor TaskCard::getPriorityColor() const
     }
 }
 
-void TaskCard::setTitle(const QString &title) 
-{ 
-    m_title = title; 
-    update();
-}
-
 QString TaskCard::title() const 
 { 
-    return m_title; 
-}
-
-void TaskCard::setDescription(const QString &description) 
-{ 
-    m_description = description; 
-    update();
+    return record().title; 
 }
 
 QString TaskCard::description() const 
 { 
-    return m_description; 
+    return record().description; 
 }
 
-void TaskCard::setPriority(Priority priority)
+QString TaskCard::descriptionPreview() const
 {
-    m_priority = priority;
-    update();
+    return record().descriptionPreview;
 }
 
-TaskCard::Priority TaskCard::priority() const
+bool TaskCard::isDescriptionLoaded() const
 {
-    return m_priority;
+    return record().descriptionLoaded;
 }
 
-void TaskCard::setDeadline(const QDateTime &deadline)
+TaskCard::Priority TaskCard::priority() const
 {
-    m_deadline = deadline;
-    update();
+    return static_cast<Priority>(record().priority);
 }
 
 QDateTime TaskCard::deadline() const
 {
-    return m_deadline;
-}
-
-void TaskCard::setAssignee(const QString &assignee)
-{
-    m_assignee = assignee;
-    update();
+    return record().deadline;
 }
 
 QString TaskCard::assignee() const
 {
-    return m_assignee;
+    return record().assignee;
 }
 
 void TaskCard::mousePressEvent(QGraphicsSceneMouseEvent *event)
@@ -417,7 +404,7 @@ void TaskCard::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
         // 如果之前未被选中，现在被选中了，则发射信号
         if (!wasSelected) {
-            emit ganttChartRequested(m_projectId);
+            emit ganttChartRequested(projectId());
         }
     }
     QGraphicsWidget::mousePressEvent(event);
@@ -453,41 +440,15 @@ bool TaskCard::isSelected() const
     return m_selected;
 }
 
-void TaskCard::setStatus(Status status)
-{
-    m_status = status;
-    update();
-}
-
 TaskCard::Status TaskCard::status() const
 {
-    return m_status;
+    return static_cast<Status>(qBound(0, record().status, 2));
 }
 
 QString TaskCard::toJson() const
 {
-    QJsonObject json;
-    json["id"] = m_id;
-    json["title"] = m_title;
-    json["description"] = m_description;
-    json["status"] = m_status;
-    json["priority"] = m_priority;
-    json["progress"] = m_progress;
-    json["projectId"] = m_projectId;
-    
-    if (m_deadline.isValid()) {
-        json["deadline"] = m_deadline.toString(Qt::ISODate);
-    }
-    
-    json["assignee"] = m_assignee;
-    
-    // 添加依赖关系
-    QJsonArray dependencies;
-    for (TaskCard* dep : m_dependencies) {
-        dependencies.append(dep->id());
-    }
-    json["dependencies"] = dependencies;
-    
-    QJsonDocument doc(json);
-    return doc.toJson();
+    // 与批量导出共用同一套编码，输出单行紧凑 JSON（描述未加载时为空，完整导出请用 TaskExporter）
+    QByteArray json;
+    TaskJsonWriter::appendRecord(json, record());
+    return QString::fromUtf8(json);
 }
\ No newline at end of file
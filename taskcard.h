@@ -10,67 +10,55 @@
 #include <QList>
 #include <QListWidget>
 #include <qabstractitemview.h>
+#include "taskrecord.h"
+#include "taskmodel.h"
 
+// 任务卡片只是绑定到 TaskModel 中某条记录的视图：不保存任务数据，只读取并绘制
+// 修改任务请通过模型进行，模型发出变更信号后由主窗口刷新对应的卡片
 class TaskCard : public QGraphicsWidget
 {
     Q_OBJECT
 
 public:
-    enum Status { Todo, InProgress, Done };
+    enum Status { Todo = TaskRecord::StatusTodo, InProgress = TaskRecord::StatusInProgress, Done = TaskRecord::StatusDone };
     enum Priority { Low, Medium, High };
+    // 悬停高亮：悬停任务的上游（它依赖的）和下游（被它阻塞的）
+    enum Highlight { NoHighlight, UpstreamHighlight, DownstreamHighlight };
     
-    explicit TaskCard(const QString &title, const QString &description, 
-                     Priority priority = Medium, 
-                     Status status = Todo,
-                     const QDateTime &deadline = QDateTime(), 
-                     const QString &assignee = QString(),
-                     const QString &projectId = QString(),
-                     QGraphicsItem *parent = nullptr);
+    TaskCard(const TaskModel *model, TaskId id, QGraphicsItem *parent = nullptr);
 
-    void setTitle(const QString &title);
+    // 绑定的记录；记录已从模型中删除时返回空记录
+    const TaskRecord &record() const;
+    TaskId id() const;
+    
     QString title() const;
-    void setDescription(const QString &description);
-    QString description() const;
-    void setStatus(Status status);
+    QString description() const;            // 仅在 isDescriptionLoaded() 时有效
+    QString descriptionPreview() const;
+    bool isDescriptionLoaded() const;
     Status status() const;
-    void setPriority(Priority priority);
     Priority priority() const;
-    void setDeadline(const QDateTime &deadline);
     QDateTime deadline() const;
-    bool isSelected() const;
-    void setAssignee(const QString &assignee);
     QString assignee() const;
-    
-    // 进度相关
-    void setProgress(int progress);
     int progress() const;
-    
-    // 依赖关系相关
-    void addDependency(TaskCard* task);
-    void removeDependency(TaskCard* task);
-    QList<TaskCard*> dependencies() const;
-    
-    // ID相关
-    QString id() const;
-    void setId(const QString &id);
-    
-    // 项目ID相关
     QString projectId() const;
-    void setProjectId(const QString &projectId);
+    QVector<TaskId> dependencyIds() const;
+    // 排期结果，没有记录时返回 nullptr
+    const TaskTiming *timing() const;
+    bool isSelected() const;
     
     // 设置颜色和字体
     void setCardColor(const QColor &color);
     void setTitleFont(const QFont &font);
     void setTextFont(const QFont &font);
+    void setHighlight(Highlight highlight);
     
-    // 导出任务为JSON格式
+    // 导出任务为JSON格式（单行，字段与批量导出相同）
     QString toJson() const;
 
 signals:
     void cardDoubleClicked(TaskCard* card);
     void cardReleased(TaskCard* card);
     void cardHovered(TaskCard* card);
-    void progressChanged(TaskCard* card, int progress);
     void ganttChartRequested(const QString &projectId);
 
 protected:
@@ -83,27 +71,16 @@ protected:
     void hoverLeaveEvent(QGraphicsSceneHoverEvent *event) override;
 
 private:
-    QString m_id;
-    QString m_title;
-    QString m_description;
-    Status m_status;
-    Priority m_priority;
-    QDateTime m_deadline;
-    QString m_assignee;
-    QString m_projectId;
+    const TaskModel *m_model;
+    TaskId m_id;
     QGraphicsLinearLayout *m_layout;
     QPointF m_dragStartPos;
     bool m_selected;
     qreal m_opacity;  // 透明度属性
     
-    // 进度相关
-    int m_progress;  // 0-100
-    
-    // 依赖相关
-    QList<TaskCard*> m_dependencies;
-    
     // 自定义样式
     QColor m_customColor;
+    Highlight m_highlight;
     QFont m_titleFont;
     QFont m_textFont;
     
@@ -0,0 +1,97 @@
+﻿#include "taskexporter.h"
+#include "taskjsonwriter.h"
+#include "taskrepository.h"
+#include <QSqlQuery>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QDebug>
+
+TaskExporter::TaskExporter(const QString &databasePath, const QString &filePath, bool compress, QObject *parent)
+    : QObject(parent),
+      m_databasePath(databasePath),
+      m_filePath(filePath),
+      m_compress(compress),
+      m_cancelled(0)
+{
+}
+
+void TaskExporter::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+bool TaskExporter::isCancelled() const
+{
+    return m_cancelled.loadAcquire() != 0;
+}
+
+void TaskExporter::exportFile()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    int exportedCount = 0;
+    qint64 bytesWritten = 0;
+    
+    TaskRepository repository("export");
+    {
+        QSaveFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Export: cannot write" << m_filePath << file.errorString();
+        } else if (repository.open(m_databasePath)) {
+            // 只读快照：日志尾部由调用方事先折叠进表（界面由持久化线程折叠，无界面导出在 runExport 中折叠）
+            // 依赖ID用单元分隔符拼接，每个任务只需一次按主键的子查询
+            repository.transaction();
+            QSqlQuery query = repository.statement(
+                "SELECT t.id, t.title, t.description, t.status, t.priority, t.deadline, "
+                "t.assignee_ref, t.progress, t.project_ref, "
+                "(SELECT group_concat(d.dependency_id, char(31)) FROM dependencies d WHERE d.task_id = t.id) "
+                "FROM tasks t ORDER BY t.rowid");
+            ok = repository.exec(query);
+            
+            TaskJsonWriter writer(&file, m_compress);
+            TaskRecord record;
+            const QChar separator(0x1f);
+            while (ok && query.next()) {
+                if (isCancelled()) {
+                    ok = false;
+                    break;
+                }
+                
+                record.id = query.value(0).toLongLong();
+                record.title = query.value(1).toString();
+                record.description = query.value(2).toString();
+                record.status = query.value(3).toInt();
+                record.priority = query.value(4).toInt();
+                QVariant deadlineValue = query.value(5);
+                record.deadline = deadlineValue.isNull() ? QDateTime()
+                                                         : QDateTime::fromMSecsSinceEpoch(deadlineValue.toLongLong());
+                record.assignee = repository.assigneeName(query.value(6).toInt());
+                record.progress = query.value(7).toInt();
+                record.projectId = repository.projectName(query.value(8).toInt());
+                record.dependencyIds.resize(0);
+                QVariant depValue = query.value(9);
+                if (!depValue.isNull()) {
+                    const QString depText = depValue.toString();
+                    for (const QStringRef &depId : depText.splitRef(separator)) {
+                        record.dependencyIds.append(depId.toLongLong());
+                    }
+                }
+                
+                ok = writer.writeRecord(record);
+                if (writer.recordCount() % PROGRESS_INTERVAL == 0) {
+                    emit progress(int(writer.recordCount()));
+                }
+            }
+            query.finish();
+            repository.commit();
+            
+            ok = ok && writer.finish() && file.commit();
+            exportedCount = int(writer.recordCount());
+            bytesWritten = writer.deviceBytes();
+        }
+    }
+    repository.close();
+    
+    emit finished(ok, exportedCount, bytesWritten, timer.elapsed());
+}
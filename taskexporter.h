@@ -0,0 +1,37 @@
+#ifndef TASKEXPORTER_H
+#define TASKEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+
+// 后台整板导出：在独立连接的读事务中逐行读取，流式写成 NDJSON（可选 gzip）
+// 读事务保证导出的是某一时刻的一致快照，GUI线程和内存占用都与看板大小无关
+class TaskExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TaskExporter(const QString &databasePath, const QString &filePath, bool compress, QObject *parent = nullptr);
+
+    void cancel();
+
+public slots:
+    void exportFile();
+
+signals:
+    void progress(int exportedCount);
+    void finished(bool ok, int exportedCount, qint64 bytesWritten, qint64 elapsedMs);
+
+private:
+    bool isCancelled() const;
+
+    QString m_databasePath;
+    QString m_filePath;
+    bool m_compress;
+    QAtomicInt m_cancelled;
+
+    static const int PROGRESS_INTERVAL = 50000;
+};
+
+#endif // TASKEXPORTER_H
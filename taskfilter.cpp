@@ -0,0 +1,214 @@
+﻿#include "taskfilter.h"
+#include <algorithm>
+#include <limits>
+#include <climits>
+
+namespace {
+
+// 每检查这么多个任务看一次是否有更新的请求
+const int CANCEL_CHECK_INTERVAL = 1024;
+
+}
+
+TaskFilterIndex::TaskFilterIndex()
+    : m_sorted(true)
+{
+}
+
+bool TaskFilterIndex::insertKey(TaskId id, const QDateTime &deadline, int assigneeHandle)
+{
+    Key key = { 0, deadline.isValid(), assigneeHandle };
+    if (key.dated) {
+        key.deadline = deadline.toMSecsSinceEpoch();
+    } else {
+        m_undated.insert(id);
+    }
+    
+    if (assigneeHandle >= m_byAssignee.size()) {
+        m_byAssignee.resize(assigneeHandle + 1);
+    }
+    m_byAssignee[assigneeHandle].insert(id);
+    m_keys.insert(id, key);
+    return key.dated;
+}
+
+void TaskFilterIndex::add(TaskId id, const QDateTime &deadline, int assigneeHandle)
+{
+    if (!insertKey(id, deadline, assigneeHandle)) {
+        return;
+    }
+    QPair<qint64, TaskId> entry(deadline.toMSecsSinceEpoch(), id);
+    if (m_sorted) {
+        m_deadlines.insert(std::lower_bound(m_deadlines.begin(), m_deadlines.end(), entry), entry);
+    } else {
+        m_deadlines.append(entry);
+    }
+}
+
+void TaskFilterIndex::append(TaskId id, const QDateTime &deadline, int assigneeHandle)
+{
+    if (insertKey(id, deadline, assigneeHandle)) {
+        m_deadlines.append(qMakePair(deadline.toMSecsSinceEpoch(), id));
+        m_sorted = false;
+    }
+}
+
+void TaskFilterIndex::remove(TaskId id)
+{
+    auto it = m_keys.find(id);
+    if (it == m_keys.end()) {
+        return;
+    }
+    Key key = it.value();
+    m_keys.erase(it);
+    
+    if (key.dated) {
+        sort();
+        QPair<qint64, TaskId> entry(key.deadline, id);
+        auto found = std::lower_bound(m_deadlines.begin(), m_deadlines.end(), entry);
+        if (found != m_deadlines.end() && *found == entry) {
+            m_deadlines.erase(found);
+        }
+    } else {
+        m_undated.remove(id);
+    }
+    if (key.assigneeHandle >= 0 && key.assigneeHandle < m_byAssignee.size()) {
+        m_byAssignee[key.assigneeHandle].remove(id);
+    }
+}
+
+void TaskFilterIndex::clear()
+{
+    m_deadlines.clear();
+    m_sorted = true;
+    m_undated.clear();
+    m_byAssignee.clear();
+    m_keys.clear();
+}
+
+void TaskFilterIndex::sort() const
+{
+    if (!m_sorted) {
+        std::sort(m_deadlines.begin(), m_deadlines.end());
+        m_sorted = true;
+    }
+}
+
+QPair<int, int> TaskFilterIndex::deadlineRange(const QDateTime &from, const QDateTime &to) const
+{
+    sort();
+    qint64 fromMsecs = from.isValid() ? from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    qint64 toMsecs = to.isValid() ? to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+    if (fromMsecs > toMsecs) {
+        return qMakePair(0, 0);
+    }
+    
+    auto first = std::lower_bound(m_deadlines.cbegin(), m_deadlines.cend(),
+                                  qMakePair(fromMsecs, std::numeric_limits<TaskId>::min()));
+    auto last = std::upper_bound(first, m_deadlines.cend(),
+                                 qMakePair(toMsecs, std::numeric_limits<TaskId>::max()));
+    return qMakePair(int(first - m_deadlines.cbegin()), int(last - m_deadlines.cbegin()));
+}
+
+bool TaskFilterIndex::evaluate(const TaskFilter &filter, const NameTable &assignees, QSet<TaskId> &visible,
+                               const QAtomicInt *cancelToken, int request) const
+{
+    visible.clear();
+    QString assigneeFilter = filter.assignee.trimmed();
+    
+    // 负责人只有几百个：先对每个不同的名字做一次子串匹配，任务只需按整数句柄查表
+    QVector<bool> assigneeMatches(assignees.size(), assigneeFilter.isEmpty());
+    if (!assigneeFilter.isEmpty()) {
+        for (int handle = 0; handle < assignees.size(); ++handle) {
+            assigneeMatches[handle] = assignees.name(handle).contains(assigneeFilter, Qt::CaseInsensitive);
+        }
+    }
+    
+    QPair<int, int> dueRange = deadlineRange(filter.from, filter.to);
+    int dateCount = dueRange.second - dueRange.first + m_undated.size();
+    int assigneeCount = INT_MAX;
+    if (!assigneeFilter.isEmpty()) {
+        assigneeCount = 0;
+        for (int handle = 0; handle < assigneeMatches.size() && handle < m_byAssignee.size(); ++handle) {
+            if (assigneeMatches.at(handle)) {
+                assigneeCount += m_byAssignee.at(handle).size();
+            }
+        }
+    }
+    int searchCount = filter.searchActive ? filter.searchRank.size() : INT_MAX;
+    
+    qint64 fromMsecs = filter.from.isValid() ? filter.from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    qint64 toMsecs = filter.to.isValid() ? filter.to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+    int checked = 0;
+    bool cancelled = false;
+    auto consider = [&](TaskId id) {
+        if (cancelToken && ++checked % CANCEL_CHECK_INTERVAL == 0 && cancelToken->load() != request) {
+            cancelled = true;
+        }
+        auto it = m_keys.constFind(id);
+        if (it == m_keys.cend()) {
+            return;
+        }
+        const Key &key = it.value();
+        if (key.dated && (key.deadline < fromMsecs || key.deadline > toMsecs)) {
+            return;
+        }
+        if (key.assigneeHandle < 0 || key.assigneeHandle >= assigneeMatches.size()
+            || !assigneeMatches.at(key.assigneeHandle)) {
+            return;
+        }
+        if (filter.searchActive && !filter.searchRank.contains(id)) {
+            return;
+        }
+        visible.insert(id);
+    };
+    
+    if (searchCount <= dateCount && searchCount <= assigneeCount) {
+        for (auto it = filter.searchRank.cbegin(); it != filter.searchRank.cend() && !cancelled; ++it) {
+            consider(it.key());
+        }
+    } else if (assigneeCount <= dateCount) {
+        for (int handle = 0; handle < m_byAssignee.size() && !cancelled; ++handle) {
+            if (handle < assigneeMatches.size() && assigneeMatches.at(handle)) {
+                for (TaskId id : m_byAssignee.at(handle)) {
+                    consider(id);
+                }
+            }
+        }
+    } else {
+        for (int i = dueRange.first; i < dueRange.second && !cancelled; ++i) {
+            consider(m_deadlines.at(i).second);
+        }
+        for (auto it = m_undated.cbegin(); it != m_undated.cend() && !cancelled; ++it) {
+            consider(*it);
+        }
+    }
+    
+    return !cancelled;
+}
+
+bool TaskFilterIndex::matches(TaskId id, const TaskFilter &filter, const NameTable &assignees) const
+{
+    auto it = m_keys.constFind(id);
+    if (it == m_keys.cend()) {
+        return false;
+    }
+    const Key &key = it.value();
+    if (key.dated) {
+        if (filter.from.isValid() && key.deadline < filter.from.toMSecsSinceEpoch()) {
+            return false;
+        }
+        if (filter.to.isValid() && key.deadline > filter.to.toMSecsSinceEpoch()) {
+            return false;
+        }
+    }
+    
+    QString assigneeFilter = filter.assignee.trimmed();
+    if (!assigneeFilter.isEmpty()) {
+        if (key.assigneeHandle < 0 || key.assigneeHandle >= assignees.size()
+            || !assignees.name(key.assigneeHandle).contains(assigneeFilter, Qt::CaseInsensitive)) {
+            return false;
+        }
+    }
+    return !filter.searchActive || filter.searchRank.contains(id);
+}
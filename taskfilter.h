@@ -0,0 +1,67 @@
+#ifndef TASKFILTER_H
+#define TASKFILTER_H
+
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QAtomicInt>
+#include "taskrecord.h"
+#include "nametable.h"
+
+// 看板的筛选条件：截止日期区间、负责人子串和全文搜索结果
+struct TaskFilter
+{
+    QDateTime from;
+    QDateTime to;
+    QString assignee;
+    bool searchActive = false;
+    QHash<TaskId, int> searchRank;      // 任务ID -> 相关度名次
+};
+
+// 筛选用的二级索引，由 TaskModel 随记录修改维护（不含占位记录）
+// 截止日期索引按 (毫秒时间, ID) 排序：批量追加后第一次查询前整体排序一次，之后的单条修改按序插入
+// 成员都是隐式共享的容器，拷贝一份交给筛选线程只增加引用计数，模型之后修改时才真正复制
+class TaskFilterIndex
+{
+public:
+    TaskFilterIndex();
+
+    // add 按序插入，append 只追加（批量加载用）
+    void add(TaskId id, const QDateTime &deadline, int assigneeHandle);
+    void append(TaskId id, const QDateTime &deadline, int assigneeHandle);
+    void remove(TaskId id);
+    void clear();
+    // 交给其他线程之前调用，保证副本是只读的
+    void sort() const;
+
+    // 求出满足条件的任务：从三个候选集合（截止日期区间加上没有截止日期的任务、匹配的负责人、搜索结果）
+    // 中最小的一个出发逐个检查其余条件，开销与匹配数有关而与任务总数无关
+    // cancelToken 不为空时定期检查，其值不再等于 request 说明有更新的请求，放弃并返回 false
+    bool evaluate(const TaskFilter &filter, const NameTable &assignees, QSet<TaskId> &visible,
+                  const QAtomicInt *cancelToken = nullptr, int request = 0) const;
+    // 单个任务是否满足条件（筛选生效期间新建或加载的卡片使用），不需要排序过的日期索引
+    bool matches(TaskId id, const TaskFilter &filter, const NameTable &assignees) const;
+
+private:
+    struct Key
+    {
+        qint64 deadline;        // 没有截止日期时不使用
+        bool dated;
+        int assigneeHandle;
+    };
+
+    // 记录负责人和筛选键，返回截止日期是否有效（有效时由调用方写入日期索引）
+    bool insertKey(TaskId id, const QDateTime &deadline, int assigneeHandle);
+    QPair<int, int> deadlineRange(const QDateTime &from, const QDateTime &to) const;
+
+    mutable QVector<QPair<qint64, TaskId>> m_deadlines;
+    mutable bool m_sorted;
+    QSet<TaskId> m_undated;
+    QVector<QSet<TaskId>> m_byAssignee;    // 按负责人句柄下标
+    QHash<TaskId, Key> m_keys;
+};
+
+#endif // TASKFILTER_H
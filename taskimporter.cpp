@@ -0,0 +1,665 @@
+﻿#include "taskimporter.h"
+#include "boardsnapshot.h"
+#include <QFileInfo>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+
+// 导入文件中可识别的字段，键名与 TaskCard::toJson 相同，CSV 表头使用同样的名字
+enum ImportField {
+    FieldUnknown = -1,
+    FieldId,
+    FieldTitle,
+    FieldDescription,
+    FieldStatus,
+    FieldPriority,
+    FieldProgress,
+    FieldProjectId,
+    FieldDeadline,
+    FieldAssignee,
+    FieldDependencies
+};
+
+ImportField fieldForKey(const QString &key)
+{
+    static const struct {
+        const char *key;
+        ImportField field;
+    } FIELD_KEYS[] = {
+        { "id", FieldId },
+        { "title", FieldTitle },
+        { "description", FieldDescription },
+        { "status", FieldStatus },
+        { "priority", FieldPriority },
+        { "progress", FieldProgress },
+        { "projectId", FieldProjectId },
+        { "project_id", FieldProjectId },
+        { "deadline", FieldDeadline },
+        { "assignee", FieldAssignee },
+        { "dependencies", FieldDependencies }
+    };
+    
+    QString trimmed = key.trimmed();
+    for (const auto &entry : FIELD_KEYS) {
+        if (trimmed.compare(QLatin1String(entry.key), Qt::CaseInsensitive) == 0) {
+            return entry.field;
+        }
+    }
+    return FieldUnknown;
+}
+
+// 解析中的一条任务：文件中的ID和依赖ID是任意文本，写入前才换成整数ID
+struct ImportedTask
+{
+    TaskRecord record;
+    QString key;
+    QStringList dependencyKeys;
+};
+
+// 把文本形式的字段值写入记录（CSV 的所有列和 JSON 中的字符串值都走这里）
+void applyTextField(ImportedTask &task, ImportField field, const QString &text)
+{
+    TaskRecord &record = task.record;
+    switch (field) {
+    case FieldId:
+        task.key = text.trimmed();
+        break;
+    case FieldTitle:
+        record.title = text;
+        break;
+    case FieldDescription:
+        record.description = text;
+        break;
+    case FieldStatus:
+        record.status = text.toInt();
+        break;
+    case FieldPriority:
+        record.priority = text.toInt();
+        break;
+    case FieldProgress:
+        record.progress = text.toInt();
+        break;
+    case FieldProjectId:
+        record.projectId = text;
+        break;
+    case FieldDeadline: {
+        // 既接受 toJson 输出的 ISO 时间，也接受毫秒时间戳
+        bool isNumber = false;
+        qint64 msecs = text.toLongLong(&isNumber);
+        record.deadline = isNumber ? QDateTime::fromMSecsSinceEpoch(msecs)
+                                   : QDateTime::fromString(text.trimmed(), Qt::ISODate);
+        break;
+    }
+    case FieldAssignee:
+        record.assignee = text;
+        break;
+    case FieldDependencies:
+        // CSV 中多个依赖以分号分隔
+        for (const QString &depId : text.split(';', QString::SkipEmptyParts)) {
+            QString trimmed = depId.trimmed();
+            if (!trimmed.isEmpty()) {
+                task.dependencyKeys.append(trimmed);
+            }
+        }
+        break;
+    case FieldUnknown:
+        break;
+    }
+}
+
+// 只解析任务对象所需的 JSON 子集，直接填充 TaskRecord，不构建 QJsonDocument
+class JsonRecordParser
+{
+public:
+    bool parse(const char *begin, const char *end, ImportedTask &task)
+    {
+        m_pos = begin;
+        m_end = end;
+        
+        skipSpace();
+        if (!consume('{')) {
+            return false;
+        }
+        skipSpace();
+        if (consume('}')) {
+            return true;
+        }
+        
+        while (true) {
+            skipSpace();
+            QString key;
+            if (!parseString(key)) {
+                return false;
+            }
+            skipSpace();
+            if (!consume(':')) {
+                return false;
+            }
+            skipSpace();
+            if (!parseValue(fieldForKey(key), task)) {
+                return false;
+            }
+            skipSpace();
+            if (consume(',')) {
+                continue;
+            }
+            return consume('}');
+        }
+    }
+
+private:
+    void skipSpace()
+    {
+        while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r' || *m_pos == '\n')) {
+            ++m_pos;
+        }
+    }
+    
+    bool consume(char c)
+    {
+        if (m_pos < m_end && *m_pos == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    
+    bool parseString(QString &out)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        
+        out.clear();
+        const char *segment = m_pos;
+        while (m_pos < m_end) {
+            char c = *m_pos;
+            if (c == '"') {
+                out += QString::fromUtf8(segment, int(m_pos - segment));
+                ++m_pos;
+                return true;
+            }
+            if (c != '\\') {
+                ++m_pos;
+                continue;
+            }
+            
+            // 转义序列：先把之前的原始片段转成 UTF-16
+            out += QString::fromUtf8(segment, int(m_pos - segment));
+            if (m_end - m_pos < 2) {
+                return false;
+            }
+            char escaped = m_pos[1];
+            m_pos += 2;
+            switch (escaped) {
+            case '"': out += QLatin1Char('"'); break;
+            case '\\': out += QLatin1Char('\\'); break;
+            case '/': out += QLatin1Char('/'); break;
+            case 'b': out += QLatin1Char('\b'); break;
+            case 'f': out += QLatin1Char('\f'); break;
+            case 'n': out += QLatin1Char('\n'); break;
+            case 'r': out += QLatin1Char('\r'); break;
+            case 't': out += QLatin1Char('\t'); break;
+            case 'u': {
+                // 代理对的两半分别是一个 QChar，按顺序追加即可
+                if (m_end - m_pos < 4) {
+                    return false;
+                }
+                bool ok = false;
+                ushort code = QByteArray::fromRawData(m_pos, 4).toUShort(&ok, 16);
+                if (!ok) {
+                    return false;
+                }
+                out += QChar(code);
+                m_pos += 4;
+                break;
+            }
+            default:
+                return false;
+            }
+            segment = m_pos;
+        }
+        return false;
+    }
+    
+    bool parseScalar(QByteArray &token)
+    {
+        const char *start = m_pos;
+        while (m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']'
+               && *m_pos != ' ' && *m_pos != '\t' && *m_pos != '\r' && *m_pos != '\n') {
+            ++m_pos;
+        }
+        token = QByteArray::fromRawData(start, int(m_pos - start));
+        return !token.isEmpty();
+    }
+    
+    bool parseValue(ImportField field, ImportedTask &task)
+    {
+        if (m_pos >= m_end) {
+            return false;
+        }
+        
+        if (*m_pos == '"') {
+            if (!parseString(m_text)) {
+                return false;
+            }
+            if (field == FieldDependencies) {
+                task.dependencyKeys.append(m_text);
+            } else {
+                applyTextField(task, field, m_text);
+            }
+            return true;
+        }
+        
+        if (*m_pos == '[') {
+            ++m_pos;
+            skipSpace();
+            if (consume(']')) {
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                if (m_pos < m_end && *m_pos == '"') {
+                    if (!parseString(m_text)) {
+                        return false;
+                    }
+                    if (field == FieldDependencies) {
+                        task.dependencyKeys.append(m_text);
+                    }
+                } else if (!parseValue(field == FieldDependencies ? field : FieldUnknown, task)) {
+                    return false;
+                }
+                skipSpace();
+                if (consume(',')) {
+                    continue;
+                }
+                return consume(']');
+            }
+        }
+        
+        if (*m_pos == '{') {
+            // 任务对象中没有嵌套对象，未知字段直接跳过
+            int depth = 0;
+            bool inString = false;
+            for (; m_pos < m_end; ++m_pos) {
+                char c = *m_pos;
+                if (inString) {
+                    if (c == '\\') {
+                        ++m_pos;
+                    } else if (c == '"') {
+                        inString = false;
+                    }
+                } else if (c == '"') {
+                    inString = true;
+                } else if (c == '{') {
+                    ++depth;
+                } else if (c == '}' && --depth == 0) {
+                    ++m_pos;
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        // 数字、true/false/null
+        QByteArray token;
+        if (!parseScalar(token)) {
+            return false;
+        }
+        if (token == "null") {
+            return true;
+        }
+        if (field == FieldDependencies) {
+            task.dependencyKeys.append(QString::fromLatin1(token));     // 数字形式的依赖ID
+        } else if (field != FieldUnknown) {
+            applyTextField(task, field, QString::fromLatin1(token));
+        }
+        return true;
+    }
+    
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
+    QString m_text;
+};
+
+// 跨行对象的完整性检测：逐段输入，花括号回到零层时一个对象结束
+struct JsonScanState
+{
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    bool started = false;
+    
+    bool feed(const char *data, int size)
+    {
+        for (int i = 0; i < size; ++i) {
+            char c = data[i];
+            if (inString) {
+                if (escape) {
+                    escape = false;
+                } else if (c == '\\') {
+                    escape = true;
+                } else if (c == '"') {
+                    inString = false;
+                }
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{') {
+                ++depth;
+                started = true;
+            } else if (c == '}') {
+                --depth;
+            }
+        }
+        return started && depth <= 0;
+    }
+};
+
+// 按 RFC 4180 拆分一条 CSV 记录（引号内可以包含逗号和换行），复用 fields 的存储
+void splitCsvRecord(const QByteArray &text, QVector<QString> &fields)
+{
+    fields.resize(0);
+    
+    int end = text.size();
+    while (end > 0 && (text.at(end - 1) == '\n' || text.at(end - 1) == '\r')) {
+        --end;
+    }
+    
+    QByteArray field;
+    bool inQuotes = false;
+    for (int i = 0; i < end; ++i) {
+        char c = text.at(i);
+        if (inQuotes) {
+            if (c == '"') {
+                if (i + 1 < end && text.at(i + 1) == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    inQuotes = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            inQuotes = true;
+        } else if (c == ',') {
+            fields.append(QString::fromUtf8(field));
+            field.resize(0);
+        } else {
+            field += c;
+        }
+    }
+    fields.append(QString::fromUtf8(field));
+}
+
+const qint64 LINE_BUFFER_SIZE = 64 * 1024;
+
+} // namespace
+
+TaskImporter::TaskImporter(const QString &databasePath, const QString &filePath, QObject *parent)
+    : QObject(parent),
+      m_databasePath(databasePath),
+      m_filePath(filePath),
+      m_cancelled(0),
+      m_repository("import"),
+      m_importedCount(0),
+      m_skippedCount(0)
+{
+    m_chunk.reserve(CHUNK_SIZE);
+}
+
+void TaskImporter::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+bool TaskImporter::isCancelled() const
+{
+    return m_cancelled.loadAcquire() != 0;
+}
+
+void TaskImporter::importFile()
+{
+    QElapsedTimer timer;
+    timer.start();
+    int dependencyCount = 0;
+    
+    if (m_repository.open(m_databasePath)) {
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug() << "Import: cannot open" << m_filePath << file.errorString();
+        } else {
+            // 导入直接写表而不经过操作日志，旧快照的序号仍然匹配，必须先作废
+            QFile::remove(BoardSnapshot::pathForDatabase(m_databasePath));
+            
+            // 依赖关系先暂存到临时表，全部任务写入后再解析
+            // 文件中不是本程序分配的ID（旧版本导出的 UUID、其他工具的数字ID）在本次导入内映射到新分配的整数ID
+            QSqlQuery setup(m_repository.database());
+            setup.exec("CREATE TEMP TABLE IF NOT EXISTS import_dependencies "
+                       "(task_id INTEGER, dependency_id INTEGER, dependency_key TEXT)");
+            setup.exec("CREATE TEMP TABLE IF NOT EXISTS import_ids (key TEXT PRIMARY KEY, id INTEGER) WITHOUT ROWID");
+            setup.exec("DELETE FROM import_dependencies");
+            setup.exec("DELETE FROM import_ids");
+            
+            m_repository.transaction();
+            bool isCsv = QFileInfo(m_filePath).suffix().compare("csv", Qt::CaseInsensitive) == 0;
+            bool ok = isCsv ? importCsv(file) : importJsonLines(file);
+            
+            if (ok && flushChunk(false)) {
+                dependencyCount = resolveDependencies();
+            } else {
+                m_repository.rollback();
+            }
+            
+            setup.exec("DROP TABLE IF EXISTS import_dependencies");
+            setup.exec("DROP TABLE IF EXISTS import_ids");
+            qDebug() << "Import: database time" << m_repository.databaseTimeNs() / 1000000 << "ms";
+        }
+    }
+    m_repository.close();
+    
+    emit finished(m_importedCount, m_skippedCount, dependencyCount, timer.elapsed());
+}
+
+bool TaskImporter::importJsonLines(QFile &file)
+{
+    // 固定大小的行缓冲，过长的行分段读入；一个对象可以跨多行（兼容 toJson 的缩进输出）
+    QByteArray buffer(int(LINE_BUFFER_SIZE), Qt::Uninitialized);
+    QByteArray pending;
+    pending.reserve(int(LINE_BUFFER_SIZE));
+    JsonScanState scan;
+    JsonRecordParser parser;
+    
+    while (!isCancelled()) {
+        qint64 length = file.readLine(buffer.data(), LINE_BUFFER_SIZE);
+        if (length <= 0) {
+            break;
+        }
+        
+        pending.append(buffer.constData(), int(length));
+        bool complete = scan.feed(buffer.constData(), int(length));
+        if (!complete) {
+            // 对象外的空行直接丢弃
+            if (!scan.started && pending.trimmed().isEmpty()) {
+                pending.resize(0);
+            }
+            continue;
+        }
+        
+        ImportedTask task;
+        if (parser.parse(pending.constData(), pending.constData() + pending.size(), task)) {
+            if (!insertRecord(task.record, task.key, task.dependencyKeys)) {
+                return false;
+            }
+        } else {
+            ++m_skippedCount;
+        }
+        pending.resize(0);
+        scan = JsonScanState();
+    }
+    
+    if (!pending.trimmed().isEmpty()) {
+        ++m_skippedCount;   // 文件末尾不完整的对象
+    }
+    return true;
+}
+
+bool TaskImporter::importCsv(QFile &file)
+{
+    QByteArray buffer(int(LINE_BUFFER_SIZE), Qt::Uninitialized);
+    QByteArray pending;
+    pending.reserve(int(LINE_BUFFER_SIZE));
+    QVector<QString> fields;
+    QVector<ImportField> columns;
+    bool inQuotes = false;
+    
+    while (!isCancelled()) {
+        qint64 length = file.readLine(buffer.data(), LINE_BUFFER_SIZE);
+        if (length <= 0) {
+            break;
+        }
+        
+        pending.append(buffer.constData(), int(length));
+        for (qint64 i = 0; i < length; ++i) {
+            if (buffer.at(int(i)) == '"') {
+                inQuotes = !inQuotes;
+            }
+        }
+        
+        // 引号未闭合或行尚未读完时继续拼接
+        if (inQuotes || (buffer.at(int(length - 1)) != '\n' && !file.atEnd())) {
+            continue;
+        }
+        
+        if (pending.trimmed().isEmpty()) {
+            pending.resize(0);
+            continue;
+        }
+        
+        if (columns.isEmpty()) {
+            // 表头，Excel 导出的文件可能带 UTF-8 BOM
+            if (pending.startsWith("\xEF\xBB\xBF")) {
+                pending.remove(0, 3);
+            }
+            splitCsvRecord(pending, fields);
+            for (const QString &name : fields) {
+                columns.append(fieldForKey(name));
+            }
+            pending.resize(0);
+            continue;
+        }
+        
+        splitCsvRecord(pending, fields);
+        pending.resize(0);
+        
+        ImportedTask task;
+        int count = qMin(fields.size(), columns.size());
+        for (int i = 0; i < count; ++i) {
+            applyTextField(task, columns.at(i), fields.at(i));
+        }
+        if (!insertRecord(task.record, task.key, task.dependencyKeys)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+TaskId TaskImporter::numericId(const QString &key)
+{
+    bool ok = false;
+    TaskId id = key.toLongLong(&ok);
+    return ok && TaskRecord::isGeneratedId(id) ? id : 0;
+}
+
+TaskId TaskImporter::idForKey(const QString &key)
+{
+    if (key.isEmpty()) {
+        return TaskRecord::newId();
+    }
+    
+    // 只有本程序分配的ID直接使用（重新导入自己的导出文件时覆盖同一任务）
+    // 其他ID（包括 1、2、3 这样的小整数，可能与迁移来的行号重合）一律映射到新ID，不覆盖已有任务
+    TaskId id = numericId(key);
+    if (id != 0) {
+        return id;
+    }
+    
+    QSqlQuery find = m_repository.statement("SELECT id FROM import_ids WHERE key = ?");
+    find.bindValue(0, key);
+    if (m_repository.exec(find) && find.next()) {
+        id = find.value(0).toLongLong();
+    }
+    find.finish();
+    if (id != 0) {
+        return id;
+    }
+    
+    id = TaskRecord::newId();
+    QSqlQuery insert = m_repository.statement("INSERT INTO import_ids (key, id) VALUES (?, ?)");
+    insert.bindValue(0, key);
+    insert.bindValue(1, id);
+    m_repository.exec(insert);
+    return id;
+}
+
+bool TaskImporter::insertRecord(TaskRecord &record, const QString &key, const QStringList &dependencyKeys)
+{
+    record.id = idForKey(key);
+    record.status = qBound(0, record.status, 2);
+    record.priority = qBound(0, record.priority, 2);
+    record.progress = qBound(0, record.progress, 100);
+    
+    // 依赖先进临时表，任务行按块交给仓库的批量写入
+    // 本程序分配的ID直接暂存，其他ID留到最后按映射表解析（目标任务可能在文件后面才出现）
+    QSqlQuery stageDependency = m_repository.statement("INSERT INTO import_dependencies (task_id, dependency_id, dependency_key) "
+                                                       "VALUES (?, ?, ?)");
+    for (const QString &depKey : dependencyKeys) {
+        TaskId depId = numericId(depKey);
+        stageDependency.bindValue(0, record.id);
+        stageDependency.bindValue(1, depId != 0 ? QVariant(depId) : QVariant(QVariant::LongLong));
+        stageDependency.bindValue(2, depId != 0 ? QVariant(QVariant::String) : QVariant(depKey));
+        m_repository.exec(stageDependency);
+    }
+    record.dependencyIds.clear();
+    
+    m_chunk.append(record);
+    if (m_chunk.size() >= CHUNK_SIZE) {
+        return flushChunk(true);
+    }
+    return true;
+}
+
+bool TaskImporter::flushChunk(bool reopen)
+{
+    // 一块记录通过同一条缓存的 UPSERT 语句写入，随后提交本块事务
+    if (!m_repository.insertMany(m_chunk) || !m_repository.commit()) {
+        qDebug() << "Import: chunk failed:" << m_repository.database().lastError().text();
+        return false;
+    }
+    
+    m_importedCount += m_chunk.size();
+    m_chunk.resize(0);
+    emit progress(m_importedCount);
+    
+    if (reopen) {
+        m_repository.transaction();
+    }
+    return true;
+}
+
+int TaskImporter::resolveDependencies()
+{
+    // 只保留目标任务确实存在的依赖，一条语句完成；文本ID通过映射表换成整数ID
+    QSqlQuery query = m_repository.statement("INSERT OR IGNORE INTO dependencies (task_id, dependency_id) "
+                                             "SELECT d.task_id, t.id FROM import_dependencies d "
+                                             "LEFT JOIN import_ids m ON m.key = d.dependency_key "
+                                             "JOIN tasks t ON t.id = IFNULL(d.dependency_id, m.id)");
+    if (!m_repository.exec(query)) {
+        return 0;
+    }
+    return query.numRowsAffected();
+}
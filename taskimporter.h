@@ -0,0 +1,57 @@
+#ifndef TASKIMPORTER_H
+#define TASKIMPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include <QFile>
+#include <QVector>
+#include "taskrecord.h"
+#include "taskrepository.h"
+
+// 后台批量导入：流式读取 JSON Lines（与 TaskCard::toJson 字段相同）或 CSV 文件
+// 逐行解析后通过同一条预编译语句分块事务写入，依赖关系在第二遍统一解析
+class TaskImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TaskImporter(const QString &databasePath, const QString &filePath, QObject *parent = nullptr);
+
+    // 可从任意线程调用，已提交的分块保留
+    void cancel();
+
+public slots:
+    void importFile();
+
+signals:
+    void progress(int importedCount);
+    void finished(int importedCount, int skippedCount, int dependencyCount, qint64 elapsedMs);
+
+private:
+    bool isCancelled() const;
+    bool importJsonLines(QFile &file);
+    bool importCsv(QFile &file);
+
+    // 收集一条解析好的记录，满一块时批量写入并提交事务
+    // key 和 dependencyKeys 是文件中的ID文本，在这里换成整数ID
+    bool insertRecord(TaskRecord &record, const QString &key, const QStringList &dependencyKeys);
+    TaskId idForKey(const QString &key);
+    // 本程序分配的十进制ID（TaskRecord::isGeneratedId），其他返回 0
+    static TaskId numericId(const QString &key);
+    bool flushChunk(bool reopen);
+    int resolveDependencies();
+
+    QString m_databasePath;
+    QString m_filePath;
+    QAtomicInt m_cancelled;
+
+    TaskRepository m_repository;
+    QVector<TaskRecord> m_chunk;
+    int m_importedCount;
+    int m_skippedCount;
+
+    static const int CHUNK_SIZE = 10000;
+};
+
+#endif // TASKIMPORTER_H
@@ -0,0 +1,316 @@
+﻿#include "taskjournal.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDataStream>
+#include <QVariant>
+#include <QDebug>
+
+namespace {
+
+// Create 记录携带的字段
+const int RECORD_FIELDS = TaskRecord::DirtyTitle | TaskRecord::DirtyDescription | TaskRecord::DirtyStatus
+                        | TaskRecord::DirtyPriority | TaskRecord::DirtyDeadline | TaskRecord::DirtyAssignee
+                        | TaskRecord::DirtyProgress | TaskRecord::DirtyProjectId;
+
+void writeFields(QDataStream &stream, const TaskRecord &record, int fields)
+{
+    if (fields & TaskRecord::DirtyTitle) stream << record.title;
+    if (fields & TaskRecord::DirtyDescription) stream << record.description;
+    if (fields & TaskRecord::DirtyStatus) stream << qint8(record.status);
+    if (fields & TaskRecord::DirtyPriority) stream << qint8(record.priority);
+    if (fields & TaskRecord::DirtyDeadline) {
+        stream << record.deadline.isValid();
+        if (record.deadline.isValid()) {
+            stream << qint64(record.deadline.toMSecsSinceEpoch());
+        }
+    }
+    if (fields & TaskRecord::DirtyAssignee) stream << record.assignee;
+    if (fields & TaskRecord::DirtyProgress) stream << qint8(record.progress);
+    if (fields & TaskRecord::DirtyProjectId) stream << record.projectId;
+}
+
+void readFields(QDataStream &stream, TaskRecord &record, int fields)
+{
+    qint8 small = 0;
+    if (fields & TaskRecord::DirtyTitle) stream >> record.title;
+    if (fields & TaskRecord::DirtyDescription) stream >> record.description;
+    if (fields & TaskRecord::DirtyStatus) { stream >> small; record.status = small; }
+    if (fields & TaskRecord::DirtyPriority) { stream >> small; record.priority = small; }
+    if (fields & TaskRecord::DirtyDeadline) {
+        bool valid = false;
+        stream >> valid;
+        record.deadline = QDateTime();
+        if (valid) {
+            qint64 msecs = 0;
+            stream >> msecs;
+            record.deadline = QDateTime::fromMSecsSinceEpoch(msecs);
+        }
+    }
+    if (fields & TaskRecord::DirtyAssignee) stream >> record.assignee;
+    if (fields & TaskRecord::DirtyProgress) { stream >> small; record.progress = small; }
+    if (fields & TaskRecord::DirtyProjectId) stream >> record.projectId;
+}
+
+} // namespace
+
+QByteArray TaskJournal::encodePayload(const TaskChange &change)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    
+    switch (change.kind) {
+    case TaskChange::Create:
+        writeFields(stream, change.record, RECORD_FIELDS);
+        stream << change.record.dependencyIds;
+        break;
+    case TaskChange::StatusChange:
+        stream << qint8(change.record.status);
+        break;
+    case TaskChange::ProgressChange:
+        stream << qint8(change.record.progress);
+        break;
+    case TaskChange::Edit:
+        stream << qint32(change.fields);
+        writeFields(stream, change.record, change.fields);
+        break;
+    default:
+        // 依赖、删除和清空操作的参数都在 task_id/other_id 列中
+        break;
+    }
+    
+    return payload;
+}
+
+void TaskJournal::decodePayload(TaskChange &change, const QByteArray &payload)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_12);
+    qint8 small = 0;
+    
+    switch (change.kind) {
+    case TaskChange::Create:
+        readFields(stream, change.record, RECORD_FIELDS);
+        stream >> change.record.dependencyIds;
+        break;
+    case TaskChange::StatusChange:
+        stream >> small;
+        change.record.status = small;
+        break;
+    case TaskChange::ProgressChange:
+        stream >> small;
+        change.record.progress = small;
+        break;
+    case TaskChange::Edit: {
+        qint32 fields = 0;
+        stream >> fields;
+        change.fields = fields;
+        readFields(stream, change.record, change.fields);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+QByteArray TaskJournal::upgradeCreatePayload(const QByteArray &payload, const QHash<QString, TaskId> &idMap)
+{
+    TaskRecord record;
+    QStringList legacyDependencyIds;
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_12);
+    readFields(in, record, RECORD_FIELDS);
+    in >> legacyDependencyIds;
+    
+    for (const QString &depId : legacyDependencyIds) {
+        TaskId id = idMap.value(depId);
+        if (id != 0) {
+            record.dependencyIds.append(id);
+        }
+    }
+    
+    TaskChange change;
+    change.kind = TaskChange::Create;
+    change.record = record;
+    return encodePayload(change);
+}
+
+bool TaskJournal::append(TaskRepository &repository, const QVector<TaskChange> &changes)
+{
+    QSqlQuery query = repository.statement("INSERT INTO task_oplog (op, task_id, other_id, payload) VALUES (?, ?, ?, ?)");
+    
+    for (const TaskChange &change : changes) {
+        query.bindValue(0, int(change.kind));
+        query.bindValue(1, change.record.id);
+        query.bindValue(2, change.otherId);
+        query.bindValue(3, encodePayload(change));
+        
+        if (!repository.exec(query)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool TaskJournal::readTail(QSqlDatabase &db, QVector<TaskChange> &changes, qint64 *lastSeq)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT seq, op, task_id, other_id, payload FROM task_oplog ORDER BY seq")) {
+        qDebug() << "Journal: read error:" << query.lastError().text();
+        return false;
+    }
+    
+    while (query.next()) {
+        TaskChange change;
+        change.kind = static_cast<TaskChange::Kind>(query.value(1).toInt());
+        change.record.id = query.value(2).toLongLong();
+        change.otherId = query.value(3).toLongLong();
+        decodePayload(change, query.value(4).toByteArray());
+        changes.append(change);
+        
+        if (lastSeq) {
+            *lastSeq = query.value(0).toLongLong();
+        }
+    }
+    
+    return true;
+}
+
+qint64 TaskJournal::lastSequence(QSqlDatabase &db)
+{
+    // AUTOINCREMENT 的计数保存在 sqlite_sequence 中，删除日志行不会影响它
+    QSqlQuery query(db);
+    if (!query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'task_oplog'")) {
+        qDebug() << "Journal: read sequence error:" << query.lastError().text();
+        return 0;
+    }
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+void TaskJournal::applyToRecord(const TaskChange &change, TaskRecord &record)
+{
+    switch (change.kind) {
+    case TaskChange::Create: {
+        TaskId id = record.id;
+        record = change.record;
+        record.id = id == 0 ? change.record.id : id;
+        record.setDescription(change.record.description);
+        break;
+    }
+    case TaskChange::StatusChange:
+        record.status = change.record.status;
+        break;
+    case TaskChange::ProgressChange:
+        record.progress = change.record.progress;
+        break;
+    case TaskChange::Edit:
+        if (change.fields & TaskRecord::DirtyTitle) record.title = change.record.title;
+        if (change.fields & TaskRecord::DirtyDescription) record.setDescription(change.record.description);
+        if (change.fields & TaskRecord::DirtyStatus) record.status = change.record.status;
+        if (change.fields & TaskRecord::DirtyPriority) record.priority = change.record.priority;
+        if (change.fields & TaskRecord::DirtyDeadline) record.deadline = change.record.deadline;
+        if (change.fields & TaskRecord::DirtyAssignee) record.assignee = change.record.assignee;
+        if (change.fields & TaskRecord::DirtyProgress) record.progress = change.record.progress;
+        if (change.fields & TaskRecord::DirtyProjectId) record.projectId = change.record.projectId;
+        break;
+    default:
+        break;
+    }
+}
+
+bool TaskJournal::loadDescription(TaskRepository &repository, TaskId id, QString &description)
+{
+    // 尚未折叠的日志中可能有更新的描述，以最后一条为准
+    QSqlQuery query = repository.statement("SELECT op, payload FROM task_oplog WHERE task_id = ? AND op IN (?, ?) ORDER BY seq");
+    query.bindValue(0, id);
+    query.bindValue(1, int(TaskChange::Create));
+    query.bindValue(2, int(TaskChange::Edit));
+    
+    bool found = false;
+    if (repository.exec(query)) {
+        while (query.next()) {
+            TaskChange change;
+            change.kind = static_cast<TaskChange::Kind>(query.value(0).toInt());
+            decodePayload(change, query.value(1).toByteArray());
+            if (change.kind == TaskChange::Create || (change.fields & TaskRecord::DirtyDescription)) {
+                description = change.record.description;
+                found = true;
+            }
+        }
+        query.finish();
+    }
+    
+    return found || repository.loadDescription(id, description);
+}
+
+bool TaskJournal::compact(TaskRepository &repository, int *foldedCount)
+{
+    if (!repository.transaction()) {
+        qDebug() << "Journal: cannot begin compaction:" << repository.database().lastError().text();
+        return false;
+    }
+    
+    QSqlDatabase db = repository.database();
+    QVector<TaskChange> changes;
+    qint64 lastSeq = 0;
+    if (!readTail(db, changes, &lastSeq)) {
+        repository.rollback();
+        return false;
+    }
+    
+    if (foldedCount) {
+        *foldedCount = changes.size();
+    }
+    
+    if (changes.isEmpty()) {
+        repository.commit();
+        return true;
+    }
+    
+    // 所有语句都来自仓库的缓存，多次压缩之间也不会重复编译
+    bool ok = true;
+    for (int i = 0; ok && i < changes.size(); ++i) {
+        const TaskChange &change = changes.at(i);
+        const TaskRecord &record = change.record;
+        
+        switch (change.kind) {
+        case TaskChange::Create:
+            ok = repository.insertMany(QVector<TaskRecord>() << record);
+            break;
+        case TaskChange::StatusChange:
+            ok = repository.updateFields(record, TaskRecord::DirtyStatus);
+            break;
+        case TaskChange::ProgressChange:
+            ok = repository.updateFields(record, TaskRecord::DirtyProgress);
+            break;
+        case TaskChange::Edit:
+            ok = repository.updateFields(record, change.fields);
+            break;
+        case TaskChange::DependencyAdd:
+            ok = repository.insertDependencies(QVector<QPair<TaskId, TaskId>>() << qMakePair(record.id, change.otherId));
+            break;
+        case TaskChange::DependencyRemove:
+            ok = repository.deleteDependencies(QVector<QPair<TaskId, TaskId>>() << qMakePair(record.id, change.otherId));
+            break;
+        case TaskChange::Remove:
+            ok = repository.deleteByIds(QVector<TaskId>() << record.id);
+            break;
+        case TaskChange::ClearAll:
+            ok = repository.clearAll();
+            break;
+        }
+    }
+    
+    QSqlQuery trimQuery = repository.statement("DELETE FROM task_oplog WHERE seq <= ?");
+    trimQuery.bindValue(0, lastSeq);
+    
+    if (!ok || !repository.exec(trimQuery) || !repository.commit()) {
+        qDebug() << "Journal: compaction failed, rolling back:" << db.lastError().text();
+        repository.rollback();
+        return false;
+    }
+    
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef TASKJOURNAL_H
+#define TASKJOURNAL_H
+
+#include <QSqlDatabase>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include "taskrecord.h"
+#include "taskrepository.h"
+
+// 只追加的操作日志：每次修改立即写入一条紧凑记录，后台再折叠进 tasks 表
+class TaskJournal
+{
+public:
+    // 把变更追加到日志末尾（调用方负责事务）
+    static bool append(TaskRepository &repository, const QVector<TaskChange> &changes);
+
+    // 按顺序读取尚未折叠的日志记录
+    static bool readTail(QSqlDatabase &db, QVector<TaskChange> &changes, qint64 *lastSeq = nullptr);
+
+    // 最后一次追加的序号，压缩后也不会回退，可作为数据库的变更计数
+    static qint64 lastSequence(QSqlDatabase &db);
+
+    // 把日志折叠进 tasks/dependencies 表并删除已折叠的记录，在单个事务中完成
+    static bool compact(TaskRepository &repository, int *foldedCount = nullptr);
+
+    // 把字段类变更（Create/StatusChange/ProgressChange/Edit）应用到内存中的记录
+    static void applyToRecord(const TaskChange &change, TaskRecord &record);
+
+    // 按需读取完整描述：先查未折叠的日志，再查 tasks 表
+    static bool loadDescription(TaskRepository &repository, TaskId id, QString &description);
+
+    // 结构迁移 v10 使用：旧格式 Create 记录末尾的依赖是字符串ID，按 idMap 改写为整数ID，映射不到的依赖丢弃
+    static QByteArray upgradeCreatePayload(const QByteArray &payload, const QHash<QString, TaskId> &idMap);
+
+private:
+    static QByteArray encodePayload(const TaskChange &change);
+    static void decodePayload(TaskChange &change, const QByteArray &payload);
+};
+
+#endif // TASKJOURNAL_H
@@ -0,0 +1,183 @@
+﻿#include "taskjsonwriter.h"
+#include <QDebug>
+
+namespace {
+
+struct Crc32Table
+{
+    quint32 entries[256];
+    
+    Crc32Table()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+quint32 crc32(const QByteArray &data)
+{
+    static const Crc32Table table;
+    
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar *p = reinterpret_cast<const uchar*>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendLittleEndian32(QByteArray &out, quint32 value)
+{
+    out.append(char(value & 0xFF));
+    out.append(char((value >> 8) & 0xFF));
+    out.append(char((value >> 16) & 0xFF));
+    out.append(char((value >> 24) & 0xFF));
+}
+
+} // namespace
+
+TaskJsonWriter::TaskJsonWriter(QIODevice *device, bool compress)
+    : m_device(device),
+      m_compress(compress),
+      m_recordCount(0),
+      m_bytesWritten(0),
+      m_deviceBytes(0)
+{
+    m_buffer.reserve(FLUSH_SIZE + 4096);
+}
+
+void TaskJsonWriter::appendString(QByteArray &out, const QString &text)
+{
+    static const char HEX[] = "0123456789abcdef";
+    
+    out.append('"');
+    QByteArray utf8 = text.toUtf8();
+    for (char c : utf8) {
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uchar(c) < 0x20) {
+                out.append("\\u00");
+                out.append(HEX[(uchar(c) >> 4) & 0xF]);
+                out.append(HEX[uchar(c) & 0xF]);
+            } else {
+                out.append(c);
+            }
+        }
+    }
+    out.append('"');
+}
+
+void TaskJsonWriter::appendId(QByteArray &out, TaskId id)
+{
+    out.append('"');
+    out.append(QByteArray::number(id));
+    out.append('"');
+}
+
+void TaskJsonWriter::appendRecord(QByteArray &out, const TaskRecord &record)
+{
+    // ID 在库内是 64 位整数，导出时才转成十进制字符串（加引号，JavaScript 读取时不会丢失精度）
+    out.append("{\"id\":");
+    appendId(out, record.id);
+    out.append(",\"title\":");
+    appendString(out, record.title);
+    out.append(",\"description\":");
+    appendString(out, record.description);
+    out.append(",\"status\":");
+    out.append(QByteArray::number(record.status));
+    out.append(",\"priority\":");
+    out.append(QByteArray::number(record.priority));
+    out.append(",\"progress\":");
+    out.append(QByteArray::number(record.progress));
+    out.append(",\"projectId\":");
+    appendString(out, record.projectId);
+    if (record.deadline.isValid()) {
+        out.append(",\"deadline\":");
+        appendString(out, record.deadline.toString(Qt::ISODate));
+    }
+    out.append(",\"assignee\":");
+    appendString(out, record.assignee);
+    out.append(",\"dependencies\":[");
+    for (int i = 0; i < record.dependencyIds.size(); ++i) {
+        if (i > 0) {
+            out.append(',');
+        }
+        appendId(out, record.dependencyIds.at(i));
+    }
+    out.append("]}");
+}
+
+bool TaskJsonWriter::writeRecord(const TaskRecord &record)
+{
+    int before = m_buffer.size();
+    appendRecord(m_buffer, record);
+    m_buffer.append('\n');
+    m_bytesWritten += m_buffer.size() - before;
+    ++m_recordCount;
+    
+    if (m_buffer.size() >= FLUSH_SIZE) {
+        return flushBuffer();
+    }
+    return true;
+}
+
+bool TaskJsonWriter::finish()
+{
+    return flushBuffer();
+}
+
+bool TaskJsonWriter::flushBuffer()
+{
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+    
+    bool ok;
+    if (m_compress) {
+        ok = writeGzipMember(m_buffer);
+    } else {
+        qint64 written = m_device->write(m_buffer);
+        ok = written == m_buffer.size();
+        m_deviceBytes += qMax<qint64>(written, 0);
+    }
+    
+    if (!ok) {
+        qDebug() << "Export: write failed:" << m_device->errorString();
+    }
+    
+    // 保留容量，下一块继续使用同一缓冲区
+    m_buffer.resize(0);
+    return ok;
+}
+
+bool TaskJsonWriter::writeGzipMember(const QByteArray &data)
+{
+    // qCompress 输出为 4 字节长度 + zlib 流（2 字节头、deflate 数据、4 字节 Adler-32）
+    // 取出其中的原始 deflate 数据，加上 gzip 头尾组成一个独立的 gzip 成员
+    QByteArray compressed = qCompress(data, 6);
+    if (compressed.size() < 10) {
+        return false;
+    }
+    
+    QByteArray member;
+    member.reserve(compressed.size() + 18);
+    static const char GZIP_HEADER[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    member.append(GZIP_HEADER, sizeof(GZIP_HEADER));
+    member.append(compressed.constData() + 6, compressed.size() - 10);
+    appendLittleEndian32(member, crc32(data));
+    appendLittleEndian32(member, quint32(data.size()));
+    
+    qint64 written = m_device->write(member);
+    m_deviceBytes += qMax<qint64>(written, 0);
+    return written == member.size();
+}
@@ -0,0 +1,43 @@
+#ifndef TASKJSONWRITER_H
+#define TASKJSONWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include "taskrecord.h"
+
+// 紧凑 NDJSON 写出器：每个任务一行，字段与 TaskCard::toJson 相同
+// 内部缓冲区反复使用，可选按块输出 gzip（多个 gzip 成员首尾相接，gunzip 可直接解压）
+class TaskJsonWriter
+{
+public:
+    explicit TaskJsonWriter(QIODevice *device, bool compress = false);
+
+    bool writeRecord(const TaskRecord &record);
+
+    // 写出缓冲区中剩余的数据
+    bool finish();
+
+    qint64 recordCount() const { return m_recordCount; }
+    qint64 bytesWritten() const { return m_bytesWritten; }      // 未压缩字节数
+    qint64 deviceBytes() const { return m_deviceBytes; }        // 实际写入设备的字节数
+
+    // 把一条记录编码为单行 JSON 追加到 out（不含换行）
+    static void appendRecord(QByteArray &out, const TaskRecord &record);
+
+private:
+    static void appendString(QByteArray &out, const QString &text);
+    static void appendId(QByteArray &out, TaskId id);
+    bool flushBuffer();
+    bool writeGzipMember(const QByteArray &data);
+
+    QIODevice *m_device;
+    bool m_compress;
+    QByteArray m_buffer;
+    qint64 m_recordCount;
+    qint64 m_bytesWritten;
+    qint64 m_deviceBytes;
+
+    static const int FLUSH_SIZE = 256 * 1024;
+};
+
+#endif // TASKJSONWRITER_H
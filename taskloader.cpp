@@ -0,0 +1,346 @@
+﻿#include "taskloader.h"
+#include "taskjournal.h"
+#include "boardsnapshot.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QDebug>
+
+namespace {
+
+// 只读取摘要列和描述预览，完整描述在打开详情时按需读取
+const char *TASK_COLUMNS = "id, title, description_preview, status, priority, deadline, assignee_ref, progress, project_ref";
+
+// 负责人和项目从连接缓存的查找表取名字，整批记录中相同的名字共享同一份字符串
+TaskRecord decodeRecord(TaskRepository &repository, const QSqlQuery &query, const QHash<TaskId, QVector<TaskId>> &dependencies)
+{
+    TaskRecord record;
+    record.id = query.value(0).toLongLong();
+    record.title = query.value(1).toString();
+    record.descriptionPreview = query.value(2).toString();
+    record.descriptionLoaded = false;
+    record.status = query.value(3).toInt();
+    record.priority = query.value(4).toInt();
+    
+    QVariant deadlineValue = query.value(5);
+    if (!deadlineValue.isNull()) {
+        record.deadline = QDateTime::fromMSecsSinceEpoch(deadlineValue.toLongLong());
+    }
+    
+    record.assignee = repository.assigneeName(query.value(6).toInt());
+    record.progress = query.value(7).toInt();
+    record.projectId = repository.projectName(query.value(8).toInt());
+    record.dependencyIds = dependencies.value(record.id);
+    return record;
+}
+
+} // namespace
+
+TaskLoader::TaskLoader(const QString &databasePath, QObject *parent)
+    : QObject(parent),
+      m_databasePath(databasePath),
+      m_cancelled(0),
+      m_useSnapshot(true),
+      m_projectFiltered(false)
+{
+}
+
+void TaskLoader::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+bool TaskLoader::isCancelled() const
+{
+    return m_cancelled.loadAcquire() != 0;
+}
+
+void TaskLoader::setUseSnapshot(bool useSnapshot)
+{
+    m_useSnapshot = useSnapshot;
+}
+
+void TaskLoader::setProject(const QString &projectId)
+{
+    m_projectFiltered = true;
+    m_projectId = projectId;
+}
+
+void TaskLoader::load()
+{
+    QElapsedTimer timer;
+    timer.start();
+    int taskCount = 0;
+    bool fromSnapshot = false;
+    
+    TaskRepository repository("loader");
+    if (repository.open(m_databasePath)) {
+        // 整个读取过程在同一个读事务中，看到的是表与日志一致的快照
+        repository.transaction();
+        
+        // 快照的变更计数与数据库一致时直接从快照构建，否则回退到 SQL
+        QSqlDatabase db = repository.database();
+        qint64 changeCounter = TaskJournal::lastSequence(db);
+        if (m_useSnapshot && !m_projectFiltered) {
+            fromSnapshot = loadFromSnapshot(changeCounter, taskCount);
+        }
+        if (!fromSnapshot) {
+            taskCount = loadFromDatabase(repository);
+        }
+        
+        repository.commit();
+        qDebug() << "Loader: database time" << repository.databaseTimeNs() / 1000000 << "ms";
+    }
+    repository.close();
+    
+    emit finished(taskCount, timer.elapsed(), fromSnapshot);
+}
+
+bool TaskLoader::loadFromSnapshot(qint64 changeCounter, int &taskCount)
+{
+    BoardSnapshot snapshot(BoardSnapshot::pathForDatabase(m_databasePath));
+    if (!snapshot.open()) {
+        return false;
+    }
+    if (snapshot.changeCounter() != changeCounter) {
+        qDebug() << "Loader: snapshot is stale, falling back to SQL";
+        return false;
+    }
+    
+    const int recordCount = snapshot.recordCount();
+    QVector<TaskRecord> batch;
+    
+    // 首批：每一列最前面的卡片
+    QVector<bool> sent(recordCount, false);
+    int headCounts[3] = { 0, 0, 0 };
+    int headTotal = 0;
+    for (int i = 0; i < recordCount && headTotal < 3 * VISIBLE_ROWS_PER_COLUMN; ++i) {
+        int column = qBound(0, snapshot.status(i), 2);
+        if (headCounts[column] < VISIBLE_ROWS_PER_COLUMN) {
+            ++headCounts[column];
+            ++headTotal;
+            sent[i] = true;
+            batch.append(snapshot.record(i));
+        }
+    }
+    taskCount = batch.size();
+    emit recordsLoaded(batch);
+    batch.clear();
+    
+    for (int i = 0; i < recordCount && !isCancelled(); ++i) {
+        if (sent.at(i)) {
+            continue;
+        }
+        batch.append(snapshot.record(i));
+        if (batch.size() >= BATCH_SIZE) {
+            taskCount += batch.size();
+            emit recordsLoaded(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.isEmpty()) {
+        taskCount += batch.size();
+        emit recordsLoaded(batch);
+    }
+    
+    return true;
+}
+
+int TaskLoader::loadFromDatabase(TaskRepository &repository)
+{
+    QSqlDatabase db = repository.database();
+    int taskCount = 0;
+    
+    // 读取尚未折叠进表的日志尾部，在内存中重放
+    QVector<TaskChange> tail;
+    TaskJournal::readTail(db, tail);
+    
+    // 最后一次清空之前的表数据和日志全部作废
+    int tailStart = 0;
+    for (int i = 0; i < tail.size(); ++i) {
+        if (tail.at(i).kind == TaskChange::ClearAll) {
+            tailStart = i + 1;
+        }
+    }
+    bool tablesCleared = tailStart > 0;
+    
+    // 按项目加载时用项目的整数引用走索引；项目不在查找表中时为 -1，查不到任何行
+    const int projectRef = m_projectFiltered ? repository.findProjectRef(m_projectId) : -1;
+    
+    // 先读依赖关系，解码任务时直接附到记录上；按项目加载时只读本项目任务的出边
+    QHash<TaskId, QVector<TaskId>> dependencies;
+    if (!tablesCleared) {
+        QSqlQuery depQuery(db);
+        depQuery.setForwardOnly(true);
+        if (m_projectFiltered) {
+            depQuery.prepare("SELECT d.task_id, d.dependency_id FROM tasks t "
+                             "JOIN dependencies d ON d.task_id = t.id WHERE t.project_ref = ?");
+            depQuery.bindValue(0, projectRef);
+        } else {
+            depQuery.prepare("SELECT task_id, dependency_id FROM dependencies");
+        }
+        if (depQuery.exec()) {
+            while (depQuery.next()) {
+                dependencies[depQuery.value(0).toLongLong()].append(depQuery.value(1).toLongLong());
+            }
+        }
+    }
+    
+    QHash<TaskId, QVector<TaskChange>> tailByTask;
+    QSet<TaskId> removedIds;
+    QVector<TaskId> createdIds;
+    for (int i = tailStart; i < tail.size(); ++i) {
+        const TaskChange &change = tail.at(i);
+        const TaskId id = change.record.id;
+        
+        switch (change.kind) {
+        case TaskChange::Create:
+            createdIds.append(id);
+            tailByTask[id].append(change);
+            dependencies[id] = change.record.dependencyIds;
+            break;
+        case TaskChange::StatusChange:
+        case TaskChange::ProgressChange:
+        case TaskChange::Edit:
+            tailByTask[id].append(change);
+            break;
+        case TaskChange::DependencyAdd:
+            if (!dependencies[id].contains(change.otherId)) {
+                dependencies[id].append(change.otherId);
+            }
+            break;
+        case TaskChange::DependencyRemove:
+            dependencies[id].removeOne(change.otherId);
+            break;
+        case TaskChange::Remove:
+            // 指向已删除任务的依赖在GUI线程按ID解析时自然被忽略
+            removedIds.insert(id);
+            dependencies.remove(id);
+            break;
+        case TaskChange::ClearAll:
+            break;
+        }
+    }
+    
+    auto replay = [&tailByTask](TaskRecord &record) {
+        for (const TaskChange &change : tailByTask.value(record.id)) {
+            TaskJournal::applyToRecord(change, record);
+        }
+    };
+    
+    // 日志中的修改可能把任务移出当前项目
+    auto inProject = [this](const TaskRecord &record) {
+        return !m_projectFiltered || record.projectId == m_projectId;
+    };
+    
+    QSet<TaskId> sentIds;
+    QVector<TaskRecord> batch;
+    
+    if (!tablesCleared) {
+        // 首批：每一列最前面的卡片，使看板在第一帧就有内容
+        QVector<TaskRecord> head;
+        for (int status = 0; status < 3; ++status) {
+            if (m_projectFiltered) {
+                repository.loadProjectByStatus(m_projectId, status, head, VISIBLE_ROWS_PER_COLUMN);
+            } else {
+                repository.loadByStatus(status, head, VISIBLE_ROWS_PER_COLUMN);
+            }
+        }
+        for (TaskRecord &record : head) {
+            sentIds.insert(record.id);
+            if (!removedIds.contains(record.id)) {
+                record.dependencyIds = dependencies.value(record.id);
+                replay(record);
+                if (inProject(record)) {
+                    batch.append(record);
+                }
+            }
+        }
+        taskCount += batch.size();
+        emit recordsLoaded(batch);
+        batch.clear();
+        
+        // 其余任务按行号顺序分批发送；按项目加载时只扫描该项目的索引范围
+        QSqlQuery query;
+        if (m_projectFiltered) {
+            query = repository.statement(QString("SELECT %1 FROM tasks WHERE project_ref = ? ORDER BY status, rowid")
+                                         .arg(TASK_COLUMNS));
+            query.bindValue(0, projectRef);
+        } else {
+            query = repository.statement(QString("SELECT %1 FROM tasks ORDER BY rowid").arg(TASK_COLUMNS));
+        }
+        repository.exec(query);
+        while (!isCancelled() && query.next()) {
+            TaskRecord record = decodeRecord(repository, query, dependencies);
+            if (sentIds.contains(record.id) || removedIds.contains(record.id)) {
+                continue;
+            }
+            if (m_projectFiltered) {
+                sentIds.insert(record.id);  // 用于找出跨项目依赖的目标
+            }
+            replay(record);
+            if (!inProject(record)) {
+                continue;
+            }
+            batch.append(record);
+            if (batch.size() >= BATCH_SIZE) {
+                taskCount += batch.size();
+                emit recordsLoaded(batch);
+                batch.clear();
+            }
+        }
+        query.finish();
+    }
+    
+    // 只存在于日志中的新任务
+    for (TaskId id : createdIds) {
+        if (removedIds.contains(id)) {
+            continue;
+        }
+        TaskRecord record;
+        record.id = id;
+        replay(record);
+        if (!inProject(record)) {
+            continue;
+        }
+        sentIds.insert(id);
+        record.dependencyIds = dependencies.value(id);
+        batch.append(record);
+    }
+    
+    if (!batch.isEmpty()) {
+        taskCount += batch.size();
+        emit recordsLoaded(batch);
+        batch.clear();
+    }
+    
+    if (m_projectFiltered && !isCancelled()) {
+        // 跨项目依赖的目标只读取摘要，作为不进入看板的占位卡片
+        QVector<TaskId> stubIds;
+        QSet<TaskId> seen;
+        for (TaskId id : sentIds) {
+            for (TaskId depId : dependencies.value(id)) {
+                if (!sentIds.contains(depId) && !removedIds.contains(depId) && !seen.contains(depId)) {
+                    seen.insert(depId);
+                    stubIds.append(depId);
+                }
+            }
+        }
+        
+        QVector<TaskRecord> stubs;
+        if (!tablesCleared) {
+            repository.loadSummaries(stubIds, stubs);
+        }
+        for (TaskRecord &record : stubs) {
+            replay(record);
+            record.stub = true;
+        }
+        if (!stubs.isEmpty()) {
+            emit recordsLoaded(stubs);
+        }
+    }
+    
+    return taskCount;
+}
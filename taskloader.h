@@ -0,0 +1,52 @@
+#ifndef TASKLOADER_H
+#define TASKLOADER_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include "taskrecord.h"
+#include "taskrepository.h"
+
+// 后台加载线程：在独立连接上读取并解码任务行，分批交给GUI线程创建卡片
+class TaskLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskLoader(const QString &databasePath, QObject *parent = nullptr);
+
+    // 可从任意线程调用，请求提前结束加载
+    void cancel();
+
+    // 是否尝试从二进制快照加载（基准测试可关闭以测量 SQL 路径）
+    void setUseSnapshot(bool useSnapshot);
+
+    // 只加载一个项目的任务，外加它们依赖的其他项目任务（以 stub 记录发送）
+    // 快照保存的是整个看板，按项目加载时不使用快照
+    void setProject(const QString &projectId);
+
+public slots:
+    void load();
+
+signals:
+    void recordsLoaded(const QVector<TaskRecord> &records);
+    void finished(int taskCount, qint64 readMs, bool fromSnapshot);
+
+private:
+    bool isCancelled() const;
+    bool loadFromSnapshot(qint64 changeCounter, int &taskCount);
+    int loadFromDatabase(TaskRepository &repository);
+
+    QString m_databasePath;
+    QAtomicInt m_cancelled;
+    bool m_useSnapshot;
+    bool m_projectFiltered;
+    QString m_projectId;
+
+    // 每列首屏可见的卡片数，先发送这些记录以便尽快显示
+    static const int VISIBLE_ROWS_PER_COLUMN = 16;
+    static const int BATCH_SIZE = 2000;
+};
+
+#endif // TASKLOADER_H
@@ -0,0 +1,555 @@
+﻿#include "taskmodel.h"
+#include <QDebug>
+#include <algorithm>
+
+TaskModel::TaskModel(QObject *parent)
+    : QObject(parent),
+      m_schedule(&m_graph)
+{
+    refreshSchedule();
+}
+
+int TaskModel::count() const
+{
+    return m_entries.size();
+}
+
+const TaskRecord &TaskModel::at(int index) const
+{
+    return m_entries.at(index).record;
+}
+
+bool TaskModel::contains(TaskId id) const
+{
+    return m_indexById.contains(id);
+}
+
+int TaskModel::indexOf(TaskId id) const
+{
+    return m_indexById.value(id, -1);
+}
+
+const TaskRecord *TaskModel::find(TaskId id) const
+{
+    int index = indexOf(id);
+    return index >= 0 ? &m_entries.at(index).record : nullptr;
+}
+
+void TaskModel::insertLoaded(const QVector<TaskRecord> &records)
+{
+    m_entries.reserve(m_entries.size() + records.size());
+    m_indexById.reserve(m_entries.size() + records.size());
+    // 批量加载不逐条标记，下一次取用时以当前时间为基准整体重算
+    refreshSchedule();
+    m_schedule.invalidateAll();
+    
+    for (const TaskRecord &record : records) {
+        int index = indexOf(record.id);
+        if (index >= 0) {
+            // 已有的占位记录被完整记录取代
+            Entry &entry = m_entries[index];
+            m_filterIndex.remove(record.id);
+            entry.record = record;
+            intern(entry);
+            linkDependencies(record);
+            scheduleTask(record);
+            if (!record.stub) {
+                m_filterIndex.add(record.id, record.deadline, entry.assigneeHandle);
+            }
+            continue;
+        }
+        Entry entry;
+        entry.record = record;
+        intern(entry);
+        m_indexById.insert(record.id, m_entries.size());
+        m_entries.append(entry);
+        linkDependencies(record);
+        scheduleTask(record);
+        if (!record.stub) {
+            // 批量加载只追加，截止日期索引留到第一次查询时排序
+            m_filterIndex.append(record.id, record.deadline, entry.assigneeHandle);
+        }
+    }
+}
+
+void TaskModel::finishLoading()
+{
+    const QVector<QPair<TaskId, TaskId>> edges = m_graph.cycleEdges();
+    for (const QPair<TaskId, TaskId> &edge : edges) {
+        qDebug() << "TaskModel: breaking legacy dependency cycle at" << edge.first << "->" << edge.second;
+        removeDependency(edge.first, edge.second);
+    }
+}
+
+TaskId TaskModel::create(TaskRecord record)
+{
+    if (record.id == 0) {
+        record.id = TaskRecord::newId();
+    }
+    record.progress = qBound(0, record.progress, 100);
+    record.setDescription(record.description);
+    record.stub = false;
+    // 新任务还没有被依赖，它的依赖不会成环，只需去掉自身
+    record.dependencyIds.removeAll(record.id);
+    
+    Entry entry;
+    entry.record = record;
+    entry.dirtyFields = TaskRecord::DirtyNew;
+    intern(entry);
+    m_indexById.insert(record.id, m_entries.size());
+    m_entries.append(entry);
+    m_dirtyIds.insert(record.id);
+    m_filterIndex.add(record.id, record.deadline, entry.assigneeHandle);
+    linkDependencies(record);
+    scheduleTask(record);
+    for (TaskId depId : record.dependencyIds) {
+        m_schedule.edgeChanged(record.id, depId);
+    }
+    
+    emit taskAdded(record.id);
+    return record.id;
+}
+
+void TaskModel::remove(TaskId id)
+{
+    int index = indexOf(id);
+    if (index < 0) {
+        return;
+    }
+    // 引用它的只有依赖图中的直接下游，删除节点之前取出反向边，不扫描全部任务
+    const QVector<TaskId> dependents = m_graph.dependents(id);
+    removeEntry(index);
+    
+    QVector<TaskId> changedIds;
+    for (TaskId dependentId : dependents) {
+        int dependentIndex = indexOf(dependentId);
+        if (dependentIndex >= 0) {
+            Entry &entry = m_entries[dependentIndex];
+            entry.addedDependencyIds.removeAll(id);
+            if (entry.record.dependencyIds.removeAll(id) > 0) {
+                changedIds.append(dependentId);
+            }
+        }
+    }
+    
+    emit taskRemoved(id);
+    // 删除已由 Remove 日志记录，下游任务不再标脏，只通知视图刷新依赖显示
+    for (TaskId dependentId : changedIds) {
+        emit taskChanged(dependentId, TaskRecord::DirtyDependencies);
+    }
+}
+
+void TaskModel::removeMany(const QVector<TaskId> &ids)
+{
+    QSet<TaskId> removed;
+    QSet<TaskId> dependents;       // 引用了被删任务、自身保留下来的任务
+    removed.reserve(ids.size());
+    for (TaskId id : ids) {
+        int index = indexOf(id);
+        if (index < 0) {
+            continue;
+        }
+        for (TaskId dependentId : m_graph.dependents(id)) {
+            dependents.insert(dependentId);
+        }
+        removeEntry(index);
+        removed.insert(id);
+    }
+    if (removed.isEmpty()) {
+        return;
+    }
+    
+    // 只改动被删任务的直接下游，开销与删除的边数成正比
+    auto isRemoved = [&removed](TaskId id) { return removed.contains(id); };
+    QVector<TaskId> changedIds;
+    for (TaskId dependentId : dependents) {
+        int index = indexOf(dependentId);
+        if (index < 0) {
+            continue;
+        }
+        Entry &entry = m_entries[index];
+        QVector<TaskId> &deps = entry.record.dependencyIds;
+        auto kept = std::remove_if(deps.begin(), deps.end(), isRemoved);
+        if (kept != deps.end()) {
+            deps.erase(kept, deps.end());
+            changedIds.append(dependentId);
+        }
+        QVector<TaskId> &added = entry.addedDependencyIds;
+        added.erase(std::remove_if(added.begin(), added.end(), isRemoved), added.end());
+    }
+    
+    for (TaskId id : removed) {
+        emit taskRemoved(id);
+    }
+    for (TaskId dependentId : changedIds) {
+        emit taskChanged(dependentId, TaskRecord::DirtyDependencies);
+    }
+}
+
+void TaskModel::removeEntry(int index)
+{
+    TaskId id = m_entries.at(index).record.id;
+    // 从未保存过的任务不需要写删除记录
+    if (!(m_entries.at(index).dirtyFields & TaskRecord::DirtyNew)) {
+        m_removedIds.insert(id);
+    }
+    m_filterIndex.remove(id);
+    m_schedule.removeTask(id);
+    m_graph.removeNode(id);
+    
+    // 与末尾交换后删除，保持数组连续
+    int last = m_entries.size() - 1;
+    if (index != last) {
+        m_entries[index] = m_entries.at(last);
+        m_indexById[m_entries.at(index).record.id] = index;
+    }
+    m_entries.removeLast();
+    m_indexById.remove(id);
+    m_dirtyIds.remove(id);
+}
+
+void TaskModel::removeAll()
+{
+    for (const Entry &entry : m_entries) {
+        if (!entry.record.stub && !(entry.dirtyFields & TaskRecord::DirtyNew)) {
+            m_removedIds.insert(entry.record.id);
+        }
+    }
+    m_entries.clear();
+    m_indexById.clear();
+    m_dirtyIds.clear();
+    m_filterIndex.clear();
+    m_graph.clear();
+    m_unresolvedDependents.clear();
+    m_schedule.clear();
+    emit modelReset();
+}
+
+void TaskModel::clear()
+{
+    m_entries.clear();
+    m_indexById.clear();
+    m_removedIds.clear();
+    m_dirtyIds.clear();
+    m_filterIndex.clear();
+    m_graph.clear();
+    m_unresolvedDependents.clear();
+    m_schedule.clear();
+    emit modelReset();
+}
+
+void TaskModel::linkDependencies(const TaskRecord &record)
+{
+    // 依赖图只包含模型中的任务：还没加载（或已不存在）的依赖先记下，不在图中建节点
+    m_graph.setDependencies(record.id, record.dependencyIds);
+    for (TaskId depId : record.dependencyIds) {
+        if (depId != record.id && !m_graph.contains(depId)) {
+            m_unresolvedDependents[depId].append(record.id);
+        }
+    }
+    
+    // 分批加载时依赖可能晚于引用它的任务到达，这时补上那些任务的边
+    const QVector<TaskId> waiting = m_unresolvedDependents.take(record.id);
+    for (TaskId userId : waiting) {
+        int index = indexOf(userId);
+        if (index >= 0) {
+            m_graph.setDependencies(userId, m_entries.at(index).record.dependencyIds);
+            m_schedule.edgeChanged(userId, record.id);
+        }
+    }
+}
+
+void TaskModel::intern(Entry &entry)
+{
+    entry.assigneeHandle = m_assignees.intern(entry.record.assignee);
+    entry.record.assignee = m_assignees.name(entry.assigneeHandle);
+    entry.projectHandle = m_projects.intern(entry.record.projectId);
+    entry.record.projectId = m_projects.name(entry.projectHandle);
+}
+
+const NameTable &TaskModel::assignees() const
+{
+    return m_assignees;
+}
+
+const NameTable &TaskModel::projects() const
+{
+    return m_projects;
+}
+
+int TaskModel::assigneeHandle(TaskId id) const
+{
+    int index = indexOf(id);
+    return index >= 0 ? m_entries.at(index).assigneeHandle : -1;
+}
+
+int TaskModel::projectHandle(TaskId id) const
+{
+    int index = indexOf(id);
+    return index >= 0 ? m_entries.at(index).projectHandle : -1;
+}
+
+const TaskFilterIndex &TaskModel::filterIndex() const
+{
+    m_filterIndex.sort();
+    return m_filterIndex;
+}
+
+const DependencyGraph &TaskModel::dependencyGraph() const
+{
+    return m_graph;
+}
+
+const TaskSchedule &TaskModel::schedule() const
+{
+    m_schedule.update();
+    return m_schedule;
+}
+
+void TaskModel::refreshSchedule()
+{
+    m_schedule.setReferenceTime(QDateTime::currentSecsSinceEpoch());
+}
+
+void TaskModel::scheduleTask(const TaskRecord &record)
+{
+    m_schedule.setTask(record.id, TaskSchedule::remainingFor(record), TaskSchedule::deadlineFor(record));
+}
+
+void TaskModel::markChanged(int index, int fields)
+{
+    if (fields == TaskRecord::DirtyNone) {
+        return;
+    }
+    m_entries[index].dirtyFields |= fields;
+    m_dirtyIds.insert(m_entries.at(index).record.id);
+    emit taskChanged(m_entries.at(index).record.id, fields);
+}
+
+void TaskModel::update(TaskId id, const TaskRecord &values, int fields)
+{
+    int index = indexOf(id);
+    if (index < 0) {
+        return;
+    }
+    
+    TaskRecord &record = m_entries[index].record;
+    int changed = TaskRecord::DirtyNone;
+    
+    if ((fields & TaskRecord::DirtyTitle) && record.title != values.title) {
+        record.title = values.title;
+        changed |= TaskRecord::DirtyTitle;
+    }
+    if (fields & TaskRecord::DirtyDescription) {
+        record.setDescription(values.description);
+        changed |= TaskRecord::DirtyDescription;
+    }
+    if ((fields & TaskRecord::DirtyStatus) && record.status != values.status) {
+        record.status = values.status;
+        changed |= TaskRecord::DirtyStatus;
+    }
+    if ((fields & TaskRecord::DirtyPriority) && record.priority != values.priority) {
+        record.priority = values.priority;
+        changed |= TaskRecord::DirtyPriority;
+    }
+    if ((fields & TaskRecord::DirtyDeadline) && record.deadline != values.deadline) {
+        record.deadline = values.deadline;
+        changed |= TaskRecord::DirtyDeadline;
+    }
+    if ((fields & TaskRecord::DirtyAssignee) && record.assignee != values.assignee) {
+        record.assignee = values.assignee;
+        changed |= TaskRecord::DirtyAssignee;
+    }
+    if (fields & TaskRecord::DirtyProgress) {
+        int progress = qBound(0, values.progress, 100);
+        if (record.progress != progress) {
+            record.progress = progress;
+            changed |= TaskRecord::DirtyProgress;
+        }
+    }
+    if ((fields & TaskRecord::DirtyProjectId) && record.projectId != values.projectId) {
+        record.projectId = values.projectId;
+        changed |= TaskRecord::DirtyProjectId;
+    }
+    if (changed & (TaskRecord::DirtyAssignee | TaskRecord::DirtyProjectId)) {
+        intern(m_entries[index]);
+    }
+    if ((changed & (TaskRecord::DirtyDeadline | TaskRecord::DirtyAssignee)) && !record.stub) {
+        m_filterIndex.remove(id);
+        m_filterIndex.add(id, record.deadline, m_entries.at(index).assigneeHandle);
+    }
+    if (changed & (TaskRecord::DirtyDeadline | TaskRecord::DirtyProgress | TaskRecord::DirtyStatus)) {
+        scheduleTask(record);
+    }
+    
+    markChanged(index, changed);
+}
+
+void TaskModel::updateMany(const QVector<TaskId> &ids, const TaskRecord &values, int fields)
+{
+    for (TaskId id : ids) {
+        update(id, values, fields);
+    }
+}
+
+void TaskModel::setStatus(TaskId id, int status)
+{
+    TaskRecord values;
+    values.status = status;
+    update(id, values, TaskRecord::DirtyStatus);
+}
+
+void TaskModel::setProgress(TaskId id, int progress)
+{
+    TaskRecord values;
+    values.progress = progress;
+    update(id, values, TaskRecord::DirtyProgress);
+}
+
+bool TaskModel::addDependency(TaskId id, TaskId dependencyId)
+{
+    int index = indexOf(id);
+    if (index < 0) {
+        return true;
+    }
+    
+    Entry &entry = m_entries[index];
+    if (entry.record.dependencyIds.contains(dependencyId)) {
+        return true;
+    }
+    if (!contains(dependencyId) || !m_graph.addEdge(id, dependencyId)) {
+        return false;
+    }
+    entry.record.dependencyIds.append(dependencyId);
+    m_schedule.edgeChanged(id, dependencyId);
+    // 先删后加的依赖相互抵消
+    if (!entry.removedDependencyIds.removeOne(dependencyId)) {
+        entry.addedDependencyIds.append(dependencyId);
+    }
+    markChanged(index, TaskRecord::DirtyDependencies);
+    return true;
+}
+
+void TaskModel::removeDependency(TaskId id, TaskId dependencyId)
+{
+    int index = indexOf(id);
+    if (index < 0) {
+        return;
+    }
+    
+    Entry &entry = m_entries[index];
+    if (!entry.record.dependencyIds.removeOne(dependencyId)) {
+        return;
+    }
+    m_graph.removeEdge(id, dependencyId);
+    m_schedule.edgeChanged(id, dependencyId);
+    if (!entry.addedDependencyIds.removeOne(dependencyId)) {
+        entry.removedDependencyIds.append(dependencyId);
+    }
+    markChanged(index, TaskRecord::DirtyDependencies);
+}
+
+QVector<TaskId> TaskModel::setDependencies(TaskId id, const QVector<TaskId> &dependencyIds)
+{
+    QVector<TaskId> rejected;
+    const TaskRecord *record = find(id);
+    if (!record) {
+        return rejected;
+    }
+    
+    // 先移除：去掉的边可能正好打破新边会形成的环
+    const QVector<TaskId> current = record->dependencyIds;
+    for (TaskId depId : current) {
+        if (!dependencyIds.contains(depId)) {
+            removeDependency(id, depId);
+        }
+    }
+    for (TaskId depId : dependencyIds) {
+        if (!addDependency(id, depId)) {
+            rejected.append(depId);
+        }
+    }
+    return rejected;
+}
+
+QVector<TaskChange> TaskModel::takeChanges()
+{
+    QVector<TaskChange> changes;
+    
+    for (TaskId id : m_removedIds) {
+        TaskChange change;
+        change.kind = TaskChange::Remove;
+        change.record.id = id;
+        changes.append(change);
+    }
+    
+    for (TaskId id : m_dirtyIds) {
+        Entry &entry = m_entries[indexOf(id)];
+        int fields = entry.dirtyFields;
+        if (fields == TaskRecord::DirtyNone) {
+            continue;
+        }
+        
+        TaskChange change;
+        change.record = entry.record;
+        
+        if (fields & TaskRecord::DirtyNew) {
+            // 新任务写一条完整记录，依赖关系包含在内
+            change.kind = TaskChange::Create;
+            changes.append(change);
+        } else {
+            // 常见的单字段修改使用更紧凑的专用记录
+            int fieldMask = fields & ~TaskRecord::DirtyDependencies;
+            if (fieldMask == TaskRecord::DirtyStatus) {
+                change.kind = TaskChange::StatusChange;
+                changes.append(change);
+            } else if (fieldMask == TaskRecord::DirtyProgress) {
+                change.kind = TaskChange::ProgressChange;
+                changes.append(change);
+            } else if (fieldMask != 0) {
+                change.kind = TaskChange::Edit;
+                change.fields = fieldMask;
+                changes.append(change);
+            }
+            
+            for (TaskId depId : entry.addedDependencyIds) {
+                TaskChange depChange;
+                depChange.kind = TaskChange::DependencyAdd;
+                depChange.record.id = entry.record.id;
+                depChange.otherId = depId;
+                changes.append(depChange);
+            }
+            for (TaskId depId : entry.removedDependencyIds) {
+                // 删除任务时没有回头清理这里，它的边已由 Remove 一并删除
+                if (m_removedIds.contains(depId)) {
+                    continue;
+                }
+                TaskChange depChange;
+                depChange.kind = TaskChange::DependencyRemove;
+                depChange.record.id = entry.record.id;
+                depChange.otherId = depId;
+                changes.append(depChange);
+            }
+        }
+        
+        entry.dirtyFields = TaskRecord::DirtyNone;
+        entry.addedDependencyIds.clear();
+        entry.removedDependencyIds.clear();
+    }
+    m_dirtyIds.clear();
+    m_removedIds.clear();
+    
+    return changes;
+}
+
+QVector<TaskRecord> TaskModel::snapshot() const
+{
+    QVector<TaskRecord> records;
+    records.reserve(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        if (!entry.record.stub) {
+            records.append(entry.record);
+        }
+    }
+    return records;
+}
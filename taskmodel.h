@@ -0,0 +1,121 @@
+#ifndef TASKMODEL_H
+#define TASKMODEL_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include "taskrecord.h"
+#include "nametable.h"
+#include "taskfilter.h"
+#include "dependencygraph.h"
+#include "taskschedule.h"
+
+// 纯数据的任务存储，不依赖图形项，可以在没有界面的环境中使用
+// 记录按值保存在连续数组中（删除时与末尾交换），ID -> 下标的哈希提供 O(1) 查找
+// 所有修改都经过模型：模型记录脏字段并发出变更信号，卡片只是绑定到某条记录的视图
+class TaskModel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskModel(QObject *parent = nullptr);
+
+    // 记录数（包括按项目加载时的跨项目依赖占位记录）
+    int count() const;
+    const TaskRecord &at(int index) const;
+    bool contains(TaskId id) const;
+    // 返回的指针在下一次修改模型之前有效
+    const TaskRecord *find(TaskId id) const;
+
+    // 加载数据库中已有的记录，不标脏、不发信号
+    void insertLoaded(const QVector<TaskRecord> &records);
+    // 全部记录加载完成后调用：旧数据中的循环依赖在这里断开一次（作为普通的删除依赖写入日志），
+    // 之后的依赖修改都能使用增量的拓扑序号
+    void finishLoading();
+    // 新建任务：分配ID并标记为新任务，返回ID
+    TaskId create(TaskRecord record);
+    // 删除任务，并从其他任务的依赖中移除（数据库中的边由 Remove 日志一并删除）
+    // 经依赖图的反向边只改动直接依赖它的任务，开销与相连的边数成正比
+    void remove(TaskId id);
+    // 批量删除：开销与删除的任务数和边数成正比，与任务总数无关
+    void removeMany(const QVector<TaskId> &ids);
+    // 删除全部任务并为每个已保存的任务记录 Remove（按项目清空时使用）
+    void removeAll();
+    // 只清空内存，丢弃未保存的变更（重新加载或整体清空时使用）
+    void clear();
+
+    // 按 fields 修改字段，只有值真正变化的字段才标脏；描述字段由调用方判断是否变化
+    void update(TaskId id, const TaskRecord &values, int fields);
+    // 对多条记录设置相同的字段值（多选批量操作），变更在下一次 takeChanges 时一起取出
+    void updateMany(const QVector<TaskId> &ids, const TaskRecord &values, int fields);
+    void setStatus(TaskId id, int status);
+    void setProgress(TaskId id, int progress);
+    // 依赖的任务不存在或会形成循环依赖时拒绝并返回 false
+    bool addDependency(TaskId id, TaskId dependencyId);
+    void removeDependency(TaskId id, TaskId dependencyId);
+    // 先移除不再需要的依赖再添加新的，返回因成环被拒绝的依赖
+    QVector<TaskId> setDependencies(TaskId id, const QVector<TaskId> &dependencyIds);
+
+    // 取出自上次以来的全部变更（删除在前）并把记录标记为干净
+    QVector<TaskChange> takeChanges();
+
+    // 负责人和项目名在模型内驻留为整数句柄：相同的名字只存一份，筛选和分组比较整数
+    const NameTable &assignees() const;
+    const NameTable &projects() const;
+    int assigneeHandle(TaskId id) const;    // 任务不存在时返回 -1
+    int projectHandle(TaskId id) const;
+
+    // 截止日期和负责人的筛选索引，随记录修改维护；拷贝开销很小，可以交给筛选线程
+    const TaskFilterIndex &filterIndex() const;
+
+    // 依赖图，随记录的依赖关系维护；加载的数据不检查环，之后的修改都经过环检测
+    const DependencyGraph &dependencyGraph() const;
+    // 关键路径排期：修改只标记受影响的任务，取用时重算它们的上下游子图
+    const TaskSchedule &schedule() const;
+    // 以当前时间为基准整体重算（加载完成后调用）
+    void refreshSchedule();
+
+    // 跨线程使用的只读快照（QString 隐式共享，拷贝开销很小），不含占位记录
+    QVector<TaskRecord> snapshot() const;
+
+signals:
+    void taskAdded(TaskId id);
+    void taskChanged(TaskId id, int fields);
+    void taskRemoved(TaskId id);
+    void modelReset();
+
+private:
+    struct Entry
+    {
+        TaskRecord record;
+        int dirtyFields = TaskRecord::DirtyNone;
+        int assigneeHandle = 0;
+        int projectHandle = 0;
+        QVector<TaskId> addedDependencyIds;     // 自上次保存以来新增/移除的依赖，用于写操作日志
+        QVector<TaskId> removedDependencyIds;
+    };
+
+    int indexOf(TaskId id) const;
+    // 从数组和索引中移除一条记录，不处理其他任务对它的依赖
+    void removeEntry(int index);
+    void markChanged(int index, int fields);
+    // 取得名字的句柄，并让记录中的字符串与驻留表共享同一份数据
+    void intern(Entry &entry);
+    void scheduleTask(const TaskRecord &record);
+    // 按记录设置依赖图中的边，并连上之前在等待这个任务的边
+    void linkDependencies(const TaskRecord &record);
+
+    QVector<Entry> m_entries;
+    QHash<TaskId, int> m_indexById;
+    QSet<TaskId> m_removedIds;     // 已删除但尚未写入日志的任务
+    QSet<TaskId> m_dirtyIds;       // 有未保存修改的任务，保存开销只与修改数有关
+    NameTable m_assignees;          // 句柄只增不减，清空模型时保留
+    NameTable m_projects;
+    TaskFilterIndex m_filterIndex;
+    DependencyGraph m_graph;
+    QHash<TaskId, QVector<TaskId>> m_unresolvedDependents;   // 不在模型中的依赖 -> 引用它的任务
+    TaskSchedule m_schedule;        // 引用 m_graph，必须在它之后声明
+};
+
+#endif // TASKMODEL_H
@@ -0,0 +1,37 @@
+﻿#include "taskrecord.h"
+#include <QAtomicInteger>
+
+namespace {
+
+// 自定义纪元 2024-01-01 UTC，47 位毫秒数可以使用四千多年
+const qint64 ID_EPOCH_MSECS = Q_INT64_C(1704067200000);
+const int ID_SEQUENCE_BITS = 16;
+// 时间戳部分至少是纪元后一天：排除迁移来的行号和其他工具常用的小整数ID
+const qint64 ID_MIN_GENERATED_MSECS = 24 * 60 * 60 * 1000;
+
+QAtomicInteger<qint64> lastId(0);
+
+} // namespace
+
+// ID 由毫秒时间戳左移 16 位构成，同一毫秒内依次加一：进程内严格递增，
+// 重启后也大于之前分配过的ID，不需要先读数据库。旧数据迁移来的ID是原来的行号，远小于这个范围
+TaskId TaskRecord::newId()
+{
+    const TaskId timeBased = (QDateTime::currentMSecsSinceEpoch() - ID_EPOCH_MSECS) << ID_SEQUENCE_BITS;
+    
+    qint64 last = lastId.loadAcquire();
+    while (true) {
+        TaskId next = qMax(last + 1, timeBased);
+        if (lastId.testAndSetOrdered(last, next, last)) {
+            return next;
+        }
+    }
+}
+
+bool TaskRecord::isGeneratedId(TaskId id)
+{
+    // 时间戳不能晚于现在（留一天余量给时钟偏差），超出的多半是其他系统的雪花ID
+    const qint64 msecs = id >> ID_SEQUENCE_BITS;
+    const qint64 nowMsecs = QDateTime::currentMSecsSinceEpoch() - ID_EPOCH_MSECS;
+    return msecs >= ID_MIN_GENERATED_MSECS && msecs <= nowMsecs + ID_MIN_GENERATED_MSECS;
+}
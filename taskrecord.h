@@ -0,0 +1,96 @@
+#ifndef TASKRECORD_H
+#define TASKRECORD_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QVector>
+#include <QMetaType>
+
+// 任务ID：64 位整数，同时是 tasks 表的 INTEGER PRIMARY KEY（即 rowid），0 表示无效
+// 内存中的查找、依赖边和数据库连接都直接比较整数，字符串形式只在导出时生成
+typedef qint64 TaskId;
+
+// 任务的纯数据快照，不依赖图形项，可以安全地跨线程传递
+struct TaskRecord
+{
+    // 字段标记：模型的脏字段跟踪、Edit 日志记录和按字段更新共用
+    enum DirtyField {
+        DirtyNone         = 0x000,
+        DirtyTitle        = 0x001,
+        DirtyDescription  = 0x002,
+        DirtyStatus       = 0x004,
+        DirtyPriority     = 0x008,
+        DirtyDeadline     = 0x010,
+        DirtyAssignee     = 0x020,
+        DirtyProgress     = 0x040,
+        DirtyProjectId    = 0x080,
+        DirtyDependencies = 0x100,
+        DirtyNew          = 0x200,  // 尚未写入数据库
+        DirtyAll          = 0x3FF
+    };
+
+    // 状态取值，写入数据库；TaskCard::Status 按这里定义，非界面代码（排期等）直接使用
+    enum Status {
+        StatusTodo       = 0,
+        StatusInProgress = 1,
+        StatusDone       = 2
+    };
+
+    TaskId id = 0;
+    QString title;
+    QString description;         // 完整描述，descriptionLoaded 为 false 时为空
+    QString descriptionPreview;  // 卡片上显示的描述预览
+    bool descriptionLoaded = true;
+    int status = StatusTodo;
+    int priority = 1;    // TaskCard::Priority
+    QDateTime deadline;
+    QString assignee;
+    int progress = 0;
+    QString projectId;
+    QVector<TaskId> dependencyIds;
+    bool stub = false;   // 按项目加载时，其他项目中被依赖的任务，只用于显示依赖关系
+
+    // 预览长度足够卡片省略显示，数据库中的 description_preview 列使用同样的长度
+    static const int PREVIEW_LENGTH = 200;
+    static QString previewOf(const QString &description) { return description.left(PREVIEW_LENGTH); }
+
+    // 分配新任务的ID，可从任意线程调用，见 taskrecord.cpp
+    static TaskId newId();
+    // id 是否落在 newId 的时间戳范围内（本程序分配的ID），旧数据行号和其他工具的数字ID都不在其中
+    static bool isGeneratedId(TaskId id);
+
+    void setDescription(const QString &text)
+    {
+        description = text;
+        descriptionPreview = previewOf(text);
+        descriptionLoaded = true;
+    }
+};
+
+// 交给持久化线程的一条不可变变更记录，同时也是操作日志中的一条记录
+// 枚举值会写入数据库，只能追加不能修改
+struct TaskChange
+{
+    enum Kind {
+        Create           = 1,   // 新建任务（record 为完整数据）
+        StatusChange     = 2,   // 只修改状态
+        ProgressChange   = 3,   // 只修改进度
+        Edit             = 4,   // 修改若干字段（fields 标明哪些字段）
+        DependencyAdd    = 5,   // record.id 新增依赖 otherId
+        DependencyRemove = 6,   // record.id 移除依赖 otherId
+        Remove           = 7,   // 删除任务及其依赖关系
+        ClearAll         = 8    // 清空所有任务
+    };
+
+    Kind kind = Create;
+    int fields = 0;      // TaskRecord::DirtyField 组合，仅 Edit 使用
+    TaskRecord record;
+    TaskId otherId = 0;
+};
+
+Q_DECLARE_METATYPE(TaskRecord)
+Q_DECLARE_METATYPE(TaskChange)
+Q_DECLARE_METATYPE(QVector<TaskChange>)
+
+#endif // TASKRECORD_H
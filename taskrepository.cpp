@@ -0,0 +1,550 @@
+﻿#include "taskrepository.h"
+#include "schemamigrator.h"
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QDebug>
+
+namespace {
+
+// 字段标记与列名一一对应，updateFields 只更新变化的列
+const struct { int field; const char *column; } FIELD_COLUMNS[] = {
+    { TaskRecord::DirtyTitle, "title" },
+    { TaskRecord::DirtyDescription, "description" },
+    { TaskRecord::DirtyStatus, "status" },
+    { TaskRecord::DirtyPriority, "priority" },
+    { TaskRecord::DirtyDeadline, "deadline" },
+    { TaskRecord::DirtyAssignee, "assignee_ref" },
+    { TaskRecord::DirtyProgress, "progress" },
+    { TaskRecord::DirtyProjectId, "project_ref" }
+};
+
+// 预览列总是与描述一起写入，参数顺序为 id、FIELD_COLUMNS、description_preview
+const char *UPSERT_TASK_SQL =
+    "INSERT INTO tasks (id, title, description, status, priority, deadline, assignee_ref, progress, project_ref, description_preview) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT(id) DO UPDATE SET "
+    "title = excluded.title, description = excluded.description, "
+    "status = excluded.status, priority = excluded.priority, "
+    "deadline = excluded.deadline, assignee_ref = excluded.assignee_ref, "
+    "progress = excluded.progress, project_ref = excluded.project_ref, "
+    "description_preview = excluded.description_preview";
+
+const char *SUMMARY_COLUMNS = "id, title, description_preview, status, priority, deadline, assignee_ref, progress, project_ref";
+
+// 按 SUMMARY_COLUMNS 的顺序解码一行，只含描述预览；名字取自连接的查找表缓存，相同的名字共享同一份字符串
+TaskRecord readSummary(TaskRepository &repository, const QSqlQuery &query)
+{
+    TaskRecord record;
+    record.id = query.value(0).toLongLong();
+    record.title = query.value(1).toString();
+    record.descriptionPreview = query.value(2).toString();
+    record.descriptionLoaded = false;
+    record.status = query.value(3).toInt();
+    record.priority = query.value(4).toInt();
+    QVariant deadlineValue = query.value(5);
+    if (!deadlineValue.isNull()) {
+        record.deadline = QDateTime::fromMSecsSinceEpoch(deadlineValue.toLongLong());
+    }
+    record.assignee = repository.assigneeName(query.value(6).toInt());
+    record.progress = query.value(7).toInt();
+    record.projectId = repository.projectName(query.value(8).toInt());
+    return record;
+}
+
+} // namespace
+
+TaskRepository::TaskRepository(const QString &connectionName)
+    : m_connectionName(connectionName),
+      m_databaseTimeNs(0),
+      m_executionCount(0),
+      m_hasFullTextIndex(-1),
+      m_namesLoaded(false)
+{
+}
+
+TaskRepository::~TaskRepository()
+{
+    close();
+}
+
+bool TaskRepository::open(const QString &databasePath, bool migrate)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    db.setDatabaseName(databasePath);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    
+    if (!db.open()) {
+        qDebug() << "Repository:" << m_connectionName << "connection with database failed:" << db.lastError().text();
+        return false;
+    }
+    
+    SchemaMigrator::configureConnection(db);
+    if (migrate && !SchemaMigrator::migrate(db)) {
+        qDebug() << "Error: database migration failed at version" << SchemaMigrator::currentVersion(db);
+        return false;
+    }
+    
+    return true;
+}
+
+void TaskRepository::close()
+{
+    if (!QSqlDatabase::contains(m_connectionName)) {
+        return;
+    }
+    
+    // 语句必须先于连接释放
+    m_statements.clear();
+    m_hasFullTextIndex = -1;
+    m_assigneeNames.clear();
+    m_projectNames.clear();
+    m_namesLoaded = false;
+    {
+        QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+bool TaskRepository::isOpen() const
+{
+    return QSqlDatabase::database(m_connectionName, false).isOpen();
+}
+
+QSqlDatabase TaskRepository::database() const
+{
+    return QSqlDatabase::database(m_connectionName, false);
+}
+
+QString TaskRepository::databasePath() const
+{
+    return database().databaseName();
+}
+
+bool TaskRepository::transaction()
+{
+    return database().transaction();
+}
+
+bool TaskRepository::commit()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = database().commit();
+    m_databaseTimeNs += timer.nsecsElapsed();
+    return ok;
+}
+
+void TaskRepository::rollback()
+{
+    database().rollback();
+    
+    // 回滚可能撤销了刚插入查找表的名字，缓存下次使用时重新读取
+    m_assigneeNames.clear();
+    m_projectNames.clear();
+    m_namesLoaded = false;
+}
+
+QSqlQuery TaskRepository::statement(const QString &sql)
+{
+    auto it = m_statements.constFind(sql);
+    if (it != m_statements.constEnd()) {
+        return it.value();
+    }
+    
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!query.prepare(sql)) {
+        qDebug() << "Repository: prepare failed:" << query.lastError().text() << sql;
+    }
+    m_statements.insert(sql, query);
+    return query;
+}
+
+bool TaskRepository::exec(QSqlQuery &query)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.exec();
+    m_databaseTimeNs += timer.nsecsElapsed();
+    ++m_executionCount;
+    
+    if (!ok) {
+        qDebug() << "Repository: query failed:" << query.lastError().text();
+    }
+    return ok;
+}
+
+void TaskRepository::resetStatistics()
+{
+    m_databaseTimeNs = 0;
+    m_executionCount = 0;
+}
+
+void TaskRepository::loadNames()
+{
+    m_namesLoaded = true;
+    
+    // 查找表只有几百行，打开后一次读入
+    QSqlQuery assignees = statement("SELECT id, name FROM assignees");
+    if (exec(assignees)) {
+        while (assignees.next()) {
+            m_assigneeNames.insert(assignees.value(0).toInt(), assignees.value(1).toString());
+        }
+    }
+    assignees.finish();
+    
+    QSqlQuery projects = statement("SELECT id, name FROM projects");
+    if (exec(projects)) {
+        while (projects.next()) {
+            m_projectNames.insert(projects.value(0).toInt(), projects.value(1).toString());
+        }
+    }
+    projects.finish();
+}
+
+int TaskRepository::nameRef(NameTable &names, const char *table, const QString &name, bool create)
+{
+    if (!m_namesLoaded) {
+        loadNames();
+    }
+    int ref = names.handle(name);
+    if (ref >= 0) {
+        return ref;
+    }
+    
+    // 其他连接可能已经插入了这个名字
+    QSqlQuery select = statement(QString("SELECT id FROM %1 WHERE name = ?").arg(table));
+    select.bindValue(0, name);
+    if (exec(select) && select.next()) {
+        ref = select.value(0).toInt();
+    }
+    select.finish();
+    
+    if (ref < 0 && create) {
+        QSqlQuery insert = statement(QString("INSERT INTO %1 (name) VALUES (?)").arg(table));
+        insert.bindValue(0, name);
+        if (exec(insert)) {
+            ref = insert.lastInsertId().toInt();
+        }
+    }
+    
+    if (ref >= 0) {
+        names.insert(ref, name);
+    }
+    return ref;
+}
+
+QString TaskRepository::refName(NameTable &names, const char *table, int ref)
+{
+    if (!m_namesLoaded) {
+        loadNames();
+    }
+    if (names.contains(ref)) {
+        return names.name(ref);
+    }
+    
+    // 缓存之后由其他连接插入的名字
+    QString name;
+    QSqlQuery select = statement(QString("SELECT name FROM %1 WHERE id = ?").arg(table));
+    select.bindValue(0, ref);
+    if (exec(select) && select.next()) {
+        name = select.value(0).toString();
+        names.insert(ref, name);
+    }
+    select.finish();
+    return names.name(ref);
+}
+
+int TaskRepository::assigneeRef(const QString &name)
+{
+    return qMax(0, nameRef(m_assigneeNames, "assignees", name, true));
+}
+
+int TaskRepository::projectRef(const QString &name)
+{
+    return qMax(0, nameRef(m_projectNames, "projects", name, true));
+}
+
+int TaskRepository::findProjectRef(const QString &name)
+{
+    return nameRef(m_projectNames, "projects", name, false);
+}
+
+QString TaskRepository::assigneeName(int ref)
+{
+    return refName(m_assigneeNames, "assignees", ref);
+}
+
+QString TaskRepository::projectName(int ref)
+{
+    return refName(m_projectNames, "projects", ref);
+}
+
+QVariant TaskRepository::fieldValue(const TaskRecord &record, int field)
+{
+    switch (field) {
+    case TaskRecord::DirtyTitle: return record.title;
+    case TaskRecord::DirtyDescription: return record.description;
+    case TaskRecord::DirtyStatus: return record.status;
+    case TaskRecord::DirtyPriority: return record.priority;
+    case TaskRecord::DirtyDeadline:
+        return record.deadline.isValid() ? QVariant(record.deadline.toMSecsSinceEpoch()) : QVariant(QVariant::LongLong);
+    case TaskRecord::DirtyAssignee: return assigneeRef(record.assignee);
+    case TaskRecord::DirtyProgress: return record.progress;
+    case TaskRecord::DirtyProjectId: return projectRef(record.projectId);
+    }
+    return QVariant();
+}
+
+bool TaskRepository::insertMany(const QVector<TaskRecord> &records)
+{
+    QSqlQuery upsert = statement(UPSERT_TASK_SQL);
+    QSqlQuery addDep = statement("INSERT OR IGNORE INTO dependencies (task_id, dependency_id) VALUES (?, ?)");
+    
+    for (const TaskRecord &record : records) {
+        upsert.bindValue(0, record.id);
+        int index = 1;
+        for (const auto &column : FIELD_COLUMNS) {
+            upsert.bindValue(index++, fieldValue(record, column.field));
+        }
+        upsert.bindValue(index, TaskRecord::previewOf(record.description));
+        if (!exec(upsert)) {
+            return false;
+        }
+        
+        for (TaskId depId : record.dependencyIds) {
+            addDep.bindValue(0, record.id);
+            addDep.bindValue(1, depId);
+            if (!exec(addDep)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::updateFields(const TaskRecord &record, int fields)
+{
+    // SQL 由字段组合决定，同一组合命中同一条缓存语句
+    QStringList assignments;
+    for (const auto &column : FIELD_COLUMNS) {
+        if (fields & column.field) {
+            assignments << QString("%1 = ?").arg(column.column);
+        }
+    }
+    if (assignments.isEmpty()) {
+        return true;
+    }
+    if (fields & TaskRecord::DirtyDescription) {
+        assignments << "description_preview = ?";
+    }
+    
+    QSqlQuery update = statement(QString("UPDATE tasks SET %1 WHERE id = ?").arg(assignments.join(", ")));
+    int index = 0;
+    for (const auto &column : FIELD_COLUMNS) {
+        if (fields & column.field) {
+            update.bindValue(index++, fieldValue(record, column.field));
+        }
+    }
+    if (fields & TaskRecord::DirtyDescription) {
+        update.bindValue(index++, TaskRecord::previewOf(record.description));
+    }
+    update.bindValue(index, record.id);
+    return exec(update);
+}
+
+bool TaskRepository::deleteByIds(const QVector<TaskId> &ids)
+{
+    QSqlQuery deleteTask = statement("DELETE FROM tasks WHERE id = ?");
+    // 两个条件分别走主键 (task_id, ...) 和 idx_dependencies_dependency，只触及该任务的边，不扫描全表
+    QSqlQuery deleteEdges = statement("DELETE FROM dependencies WHERE task_id = ? OR dependency_id = ?");
+    
+    for (TaskId id : ids) {
+        deleteTask.bindValue(0, id);
+        deleteEdges.bindValue(0, id);
+        deleteEdges.bindValue(1, id);
+        if (!exec(deleteTask) || !exec(deleteEdges)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::insertDependencies(const QVector<QPair<TaskId, TaskId>> &edges)
+{
+    QSqlQuery addDep = statement("INSERT OR IGNORE INTO dependencies (task_id, dependency_id) VALUES (?, ?)");
+    for (const auto &edge : edges) {
+        addDep.bindValue(0, edge.first);
+        addDep.bindValue(1, edge.second);
+        if (!exec(addDep)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::deleteDependencies(const QVector<QPair<TaskId, TaskId>> &edges)
+{
+    QSqlQuery removeDep = statement("DELETE FROM dependencies WHERE task_id = ? AND dependency_id = ?");
+    for (const auto &edge : edges) {
+        removeDep.bindValue(0, edge.first);
+        removeDep.bindValue(1, edge.second);
+        if (!exec(removeDep)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::clearAll()
+{
+    QSqlQuery clearTasks = statement("DELETE FROM tasks");
+    QSqlQuery clearDeps = statement("DELETE FROM dependencies");
+    return exec(clearTasks) && exec(clearDeps);
+}
+
+bool TaskRepository::loadByStatus(int status, QVector<TaskRecord> &records, int limit)
+{
+    // LIMIT -1 在 SQLite 中表示不限制；只读预览，完整描述按需加载
+    QSqlQuery query = statement(QString("SELECT %1 FROM tasks WHERE status = ? ORDER BY rowid LIMIT ?").arg(SUMMARY_COLUMNS));
+    query.bindValue(0, status);
+    query.bindValue(1, limit);
+    if (!exec(query)) {
+        return false;
+    }
+    
+    while (query.next()) {
+        records.append(readSummary(*this, query));
+    }
+    query.finish();
+    return true;
+}
+
+bool TaskRepository::loadProjectByStatus(const QString &projectId, int status, QVector<TaskRecord> &records, int limit)
+{
+    // 走 (project_ref, status) 索引，同一项目同一状态内按行号有序；未知项目的引用为 -1，查不到任何行
+    QSqlQuery query = statement(QString("SELECT %1 FROM tasks WHERE project_ref = ? AND status = ? ORDER BY rowid LIMIT ?")
+                                .arg(SUMMARY_COLUMNS));
+    query.bindValue(0, findProjectRef(projectId));
+    query.bindValue(1, status);
+    query.bindValue(2, limit);
+    if (!exec(query)) {
+        return false;
+    }
+    
+    while (query.next()) {
+        records.append(readSummary(*this, query));
+    }
+    query.finish();
+    return true;
+}
+
+bool TaskRepository::loadSummaries(const QVector<TaskId> &ids, QVector<TaskRecord> &records)
+{
+    QSqlQuery query = statement(QString("SELECT %1 FROM tasks WHERE id = ?").arg(SUMMARY_COLUMNS));
+    for (TaskId id : ids) {
+        query.bindValue(0, id);
+        if (!exec(query)) {
+            return false;
+        }
+        if (query.next()) {
+            records.append(readSummary(*this, query));
+        }
+        query.finish();
+    }
+    return true;
+}
+
+bool TaskRepository::loadProjects(QVector<QPair<QString, int>> &projects)
+{
+    // 分组走项目索引，不读取任务行本身；每组只按主键查一次项目名
+    QSqlQuery query = statement("SELECT p.name, COUNT(*) FROM tasks t JOIN projects p ON p.id = t.project_ref "
+                                "GROUP BY t.project_ref ORDER BY p.name");
+    if (!exec(query)) {
+        return false;
+    }
+    
+    while (query.next()) {
+        projects.append(qMakePair(query.value(0).toString(), query.value(1).toInt()));
+    }
+    query.finish();
+    return true;
+}
+
+bool TaskRepository::loadDescription(TaskId id, QString &description)
+{
+    QSqlQuery query = statement("SELECT description FROM tasks WHERE id = ?");
+    query.bindValue(0, id);
+    if (!exec(query) || !query.next()) {
+        return false;
+    }
+    description = query.value(0).toString();
+    query.finish();
+    return true;
+}
+
+bool TaskRepository::search(const QString &text, QVector<TaskId> &ids, int limit, int *totalCount)
+{
+    if (totalCount) {
+        *totalCount = 0;
+    }
+    QStringList terms = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    if (terms.isEmpty()) {
+        return true;
+    }
+    
+    if (m_hasFullTextIndex < 0) {
+        QSqlQuery probe = statement("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'tasks_fts'");
+        m_hasFullTextIndex = exec(probe) && probe.next() ? 1 : 0;
+        probe.finish();
+    }
+    
+    QSqlQuery query;
+    QSqlQuery count;
+    if (m_hasFullTextIndex) {
+        // 每个词加引号转义后做前缀匹配，多个词之间为 AND
+        QStringList phrases;
+        for (QString term : terms) {
+            phrases << QString("\"%1\"*").arg(term.replace('"', "\"\""));
+        }
+        const QString match = phrases.join(' ');
+        query = statement("SELECT t.id FROM tasks_fts JOIN tasks t ON t.rowid = tasks_fts.rowid "
+                          "WHERE tasks_fts MATCH ? ORDER BY bm25(tasks_fts, 10.0, 1.0) LIMIT ?");
+        query.bindValue(0, match);
+        query.bindValue(1, limit);
+        count = statement("SELECT count(*) FROM tasks_fts WHERE tasks_fts MATCH ?");
+        count.bindValue(0, match);
+    } else {
+        // 用户输入中的通配符按字面匹配：先转义转义符本身，再转义 % 和 _
+        QString literal = text.trimmed();
+        literal.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+        QString pattern = QString("%%1%").arg(literal);
+        query = statement("SELECT id FROM tasks WHERE title LIKE ? ESCAPE '\\' OR description LIKE ? ESCAPE '\\' LIMIT ?");
+        query.bindValue(0, pattern);
+        query.bindValue(1, pattern);
+        query.bindValue(2, limit);
+        count = statement("SELECT count(*) FROM tasks WHERE title LIKE ? ESCAPE '\\' OR description LIKE ? ESCAPE '\\'");
+        count.bindValue(0, pattern);
+        count.bindValue(1, pattern);
+    }
+    
+    if (!exec(query)) {
+        return false;
+    }
+    while (query.next()) {
+        ids.append(query.value(0).toLongLong());
+    }
+    query.finish();
+    
+    if (totalCount) {
+        *totalCount = ids.size();
+        // 只有被截断时才需要计数，计数不排序、不回表，比取结果便宜
+        if (ids.size() >= limit && exec(count) && count.next()) {
+            *totalCount = count.value(0).toInt();
+        }
+        count.finish();
+    }
+    return true;
+}
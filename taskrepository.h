@@ -0,0 +1,88 @@
+#ifndef TASKREPOSITORY_H
+#define TASKREPOSITORY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include "taskrecord.h"
+#include "nametable.h"
+
+// 任务数据访问层：每个实例拥有一个命名连接
+// 预编译语句按 SQL 文本缓存，整个连接生命周期内只编译一次
+// 所有执行都经过 exec() 计时，便于统计数据库耗时
+class TaskRepository
+{
+public:
+    explicit TaskRepository(const QString &connectionName);
+    ~TaskRepository();
+
+    // 打开连接并设置 WAL 等参数，migrate 为 true 时执行结构迁移
+    bool open(const QString &databasePath, bool migrate = false);
+    void close();
+    bool isOpen() const;
+
+    QSqlDatabase database() const;
+    QString databasePath() const;
+
+    bool transaction();
+    bool commit();
+    void rollback();
+
+    // 批量操作，调用方负责事务
+    bool insertMany(const QVector<TaskRecord> &records);            // 按 id UPSERT，依赖一并写入
+    bool updateFields(const TaskRecord &record, int fields);         // fields 为 TaskRecord::DirtyField 组合
+    bool deleteByIds(const QVector<TaskId> &ids);                    // 同时删除相关的依赖边
+    bool insertDependencies(const QVector<QPair<TaskId, TaskId>> &edges);
+    bool deleteDependencies(const QVector<QPair<TaskId, TaskId>> &edges);
+    bool clearAll();
+    bool loadByStatus(int status, QVector<TaskRecord> &records, int limit = -1);   // 只含描述预览
+    bool loadProjectByStatus(const QString &projectId, int status, QVector<TaskRecord> &records, int limit = -1);
+    bool loadSummaries(const QVector<TaskId> &ids, QVector<TaskRecord> &records);    // 按ID读取，不存在的忽略
+    bool loadProjects(QVector<QPair<QString, int>> &projects);                    // 项目ID及其任务数
+    bool loadDescription(TaskId id, QString &description);
+
+    // 全文搜索标题和描述，按相关度排序返回任务ID（标题权重更高）
+    // totalCount 不为空时给出匹配总数：结果达到 limit 时另做一次计数，否则就是返回的个数
+    bool search(const QString &text, QVector<TaskId> &ids, int limit, int *totalCount = nullptr);
+
+    // 取缓存中的预编译语句（QSqlQuery 隐式共享，返回的副本与缓存共用同一语句）
+    QSqlQuery statement(const QString &sql);
+    bool exec(QSqlQuery &query);
+
+    // 数据库耗时统计
+    qint64 databaseTimeNs() const { return m_databaseTimeNs; }
+    qint64 executionCount() const { return m_executionCount; }
+    int cachedStatementCount() const { return m_statements.size(); }
+    void resetStatistics();
+
+    // 字段标记对应的列值，负责人和项目转换为查找表引用
+    QVariant fieldValue(const TaskRecord &record, int field);
+
+    // 负责人和项目名保存在查找表中，任务行只存整数引用（0 表示未分配）
+    // 每个连接缓存一份查找表；引用一经分配不再改变，缓存只会不完整、不会过期
+    int assigneeRef(const QString &name);           // 新名字插入查找表，调用方负责事务
+    int projectRef(const QString &name);
+    int findProjectRef(const QString &name);        // 只查找不插入，不存在时返回 -1，供读事务使用
+    QString assigneeName(int ref);
+    QString projectName(int ref);
+
+private:
+    int nameRef(NameTable &names, const char *table, const QString &name, bool create);
+    QString refName(NameTable &names, const char *table, int ref);
+    void loadNames();
+
+    QString m_connectionName;
+    QHash<QString, QSqlQuery> m_statements;
+    qint64 m_databaseTimeNs;
+    qint64 m_executionCount;
+    int m_hasFullTextIndex;     // -1 表示尚未检查
+    NameTable m_assigneeNames;
+    NameTable m_projectNames;
+    bool m_namesLoaded;
+};
+
+#endif // TASKREPOSITORY_H
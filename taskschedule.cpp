@@ -0,0 +1,286 @@
+﻿#include "taskschedule.h"
+#include <QPair>
+#include <queue>
+#include <vector>
+
+TaskSchedule::TaskSchedule(const DependencyGraph *graph)
+    : m_graph(graph),
+      m_referenceTime(0),
+      m_rebuild(false),
+      m_lastUpdateCount(0)
+{
+}
+
+qint64 TaskSchedule::remainingFor(const TaskRecord &record)
+{
+    if (record.status == TaskRecord::StatusDone) {
+        return 0;
+    }
+    return NOMINAL_DURATION_SECS * (100 - qBound(0, record.progress, 100)) / 100;
+}
+
+qint64 TaskSchedule::deadlineFor(const TaskRecord &record)
+{
+    if (!record.deadline.isValid()) {
+        return TaskTiming::NO_DEADLINE;
+    }
+    return record.deadline.toSecsSinceEpoch();
+}
+
+void TaskSchedule::setReferenceTime(qint64 secs)
+{
+    if (m_referenceTime != secs) {
+        m_referenceTime = secs;
+        invalidateAll();
+    }
+}
+
+void TaskSchedule::setTask(TaskId id, qint64 remaining, qint64 deadline)
+{
+    auto it = m_timings.find(id);
+    if (it == m_timings.end()) {
+        TaskTiming timing;
+        timing.remaining = remaining;
+        timing.deadline = deadline;
+        m_timings.insert(id, timing);
+        if (!m_rebuild) {
+            m_dirtyForward.insert(id);
+            m_dirtyBackward.insert(id);
+        }
+        return;
+    }
+    
+    // 工期影响自身和下游的最早时间，以及上游的最晚完成时间；截止日期只影响自身和上游
+    if (it->remaining != remaining) {
+        it->remaining = remaining;
+        if (!m_rebuild) {
+            m_dirtyForward.insert(id);
+            m_dirtyBackward.insert(id);
+        }
+    }
+    if (it->deadline != deadline) {
+        it->deadline = deadline;
+        if (!m_rebuild) {
+            m_dirtyBackward.insert(id);
+        }
+    }
+}
+
+void TaskSchedule::removeTask(TaskId id)
+{
+    int node = m_graph->nodeIndex(id);
+    if (node >= 0 && !m_rebuild) {
+        for (int dep : m_graph->dependencyNodes(node)) {
+            m_dirtyBackward.insert(m_graph->idAt(dep));
+        }
+        for (int user : m_graph->dependentNodes(node)) {
+            m_dirtyForward.insert(m_graph->idAt(user));
+        }
+    }
+    m_timings.remove(id);
+    m_dirtyForward.remove(id);
+    m_dirtyBackward.remove(id);
+}
+
+void TaskSchedule::edgeChanged(TaskId id, TaskId dependencyId)
+{
+    if (!m_rebuild) {
+        m_dirtyForward.insert(id);
+        m_dirtyBackward.insert(dependencyId);
+    }
+}
+
+void TaskSchedule::invalidateAll()
+{
+    m_rebuild = true;
+    m_dirtyForward.clear();
+    m_dirtyBackward.clear();
+}
+
+void TaskSchedule::clear()
+{
+    m_timings.clear();
+    m_dirtyForward.clear();
+    m_dirtyBackward.clear();
+    m_rebuild = false;
+}
+
+void TaskSchedule::update() const
+{
+    m_lastUpdateCount = 0;
+    if (m_rebuild) {
+        rebuild();
+        return;
+    }
+    if (m_dirtyForward.isEmpty() && m_dirtyBackward.isEmpty()) {
+        return;
+    }
+    propagateForward();
+    propagateBackward();
+}
+
+const TaskTiming *TaskSchedule::timing(TaskId id) const
+{
+    auto it = m_timings.constFind(id);
+    return it != m_timings.constEnd() ? &it.value() : nullptr;
+}
+
+QVector<TaskId> TaskSchedule::criticalPath(TaskId id) const
+{
+    update();
+    QVector<TaskId> path;
+    QSet<TaskId> seen;
+    TaskId current = id;
+    
+    while (const TaskTiming *timing = this->timing(current)) {
+        path.prepend(current);
+        seen.insert(current);
+        int node = m_graph->nodeIndex(current);
+        if (node < 0 || timing->earliestStart <= m_referenceTime) {
+            break;
+        }
+        
+        // 最早完成时间等于本任务最早开始时间的依赖就是推迟它的那一个
+        TaskId driver = 0;
+        for (int dep : m_graph->dependencyNodes(node)) {
+            TaskId depId = m_graph->idAt(dep);
+            const TaskTiming *depTiming = this->timing(depId);
+            if (depTiming && depTiming->earliestFinish == timing->earliestStart && !seen.contains(depId)) {
+                driver = depId;
+                break;
+            }
+        }
+        if (driver == 0) {
+            break;
+        }
+        current = driver;
+    }
+    return path;
+}
+
+void TaskSchedule::rebuild() const
+{
+    QVector<int> order;
+    m_graph->topologicalNodes(order);
+    for (int node : order) {
+        computeEarliest(node);
+    }
+    for (int i = order.size() - 1; i >= 0; --i) {
+        computeLatest(order.at(i));
+    }
+    m_rebuild = false;
+    m_dirtyForward.clear();
+    m_dirtyBackward.clear();
+    m_lastUpdateCount = order.size();
+}
+
+void TaskSchedule::propagateForward() const
+{
+    // 按拓扑序号从小到大处理：轮到一个任务时，它所有可能改变的依赖都已处理完
+    // 每个任务最多入队一次；最早完成时间不变的任务不再通知下游
+    typedef QPair<int, int> Item;      // (序号, 节点)
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    QSet<int> queued;
+    for (TaskId id : m_dirtyForward) {
+        int node = m_graph->nodeIndex(id);
+        if (node >= 0) {
+            queue.push(Item(m_graph->orderOf(node), node));
+            queued.insert(node);
+        }
+    }
+    m_dirtyForward.clear();
+    
+    while (!queue.empty()) {
+        int node = queue.top().second;
+        queue.pop();
+        ++m_lastUpdateCount;
+        if (!computeEarliest(node)) {
+            continue;
+        }
+        for (int user : m_graph->dependentNodes(node)) {
+            if (!queued.contains(user)) {
+                queued.insert(user);
+                queue.push(Item(m_graph->orderOf(user), user));
+            }
+        }
+    }
+}
+
+void TaskSchedule::propagateBackward() const
+{
+    // 按序号从大到小处理；标记过的任务即使自身结果不变也要通知依赖（工期变化改变了它的最晚开始时间）
+    typedef QPair<int, int> Item;
+    std::priority_queue<Item> queue;
+    QSet<int> queued;
+    QSet<int> seeds;
+    for (TaskId id : m_dirtyBackward) {
+        int node = m_graph->nodeIndex(id);
+        if (node >= 0) {
+            queue.push(Item(m_graph->orderOf(node), node));
+            queued.insert(node);
+            seeds.insert(node);
+        }
+    }
+    m_dirtyBackward.clear();
+    
+    while (!queue.empty()) {
+        int node = queue.top().second;
+        queue.pop();
+        ++m_lastUpdateCount;
+        if (!computeLatest(node) && !seeds.contains(node)) {
+            continue;
+        }
+        for (int dep : m_graph->dependencyNodes(node)) {
+            if (!queued.contains(dep)) {
+                queued.insert(dep);
+                queue.push(Item(m_graph->orderOf(dep), dep));
+            }
+        }
+    }
+}
+
+bool TaskSchedule::computeEarliest(int node) const
+{
+    // 没有排期数据的节点不计算，也不插入默认值；作为依赖时视为没有约束
+    auto self = m_timings.find(m_graph->idAt(node));
+    if (self == m_timings.end()) {
+        return false;
+    }
+    qint64 start = m_referenceTime;
+    for (int dep : m_graph->dependencyNodes(node)) {
+        auto it = m_timings.constFind(m_graph->idAt(dep));
+        if (it != m_timings.constEnd()) {
+            start = qMax(start, it->earliestFinish);
+        }
+    }
+    TaskTiming &timing = self.value();
+    qint64 finish = start + timing.remaining;
+    if (timing.earliestStart == start && timing.earliestFinish == finish) {
+        return false;
+    }
+    timing.earliestStart = start;
+    timing.earliestFinish = finish;
+    return true;
+}
+
+bool TaskSchedule::computeLatest(int node) const
+{
+    // 依赖它的任务必须在各自的最晚开始时间之前拿到它的结果
+    auto self = m_timings.find(m_graph->idAt(node));
+    if (self == m_timings.end()) {
+        return false;
+    }
+    qint64 finish = self->deadline;
+    for (int user : m_graph->dependentNodes(node)) {
+        auto it = m_timings.constFind(m_graph->idAt(user));
+        if (it != m_timings.constEnd() && it->constrained()) {
+            finish = qMin(finish, it->latestFinish - it->remaining);
+        }
+    }
+    TaskTiming &timing = self.value();
+    if (timing.latestFinish == finish) {
+        return false;
+    }
+    timing.latestFinish = finish;
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef TASKSCHEDULE_H
+#define TASKSCHEDULE_H
+
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <limits>
+#include "taskrecord.h"
+#include "dependencygraph.h"
+
+// 一个任务的排期结果，时间都是秒（Unix 时间）
+struct TaskTiming
+{
+    static const qint64 NO_DEADLINE = std::numeric_limits<qint64>::max();
+
+    qint64 remaining = 0;                   // 剩余工期
+    qint64 deadline = NO_DEADLINE;
+    qint64 earliestStart = 0;               // 所有依赖最早完成、且不早于基准时间
+    qint64 earliestFinish = 0;
+    qint64 latestFinish = NO_DEADLINE;      // 不耽误自身和下游任何截止日期的最晚完成时间
+
+    // 自身和下游都没有截止日期时不受约束，没有余量可言
+    bool constrained() const { return latestFinish != NO_DEADLINE; }
+    qint64 slack() const { return latestFinish - earliestFinish; }
+    // 余量不为正：在关键路径上，再有延误就会错过某个截止日期
+    bool critical() const { return constrained() && slack() <= 0; }
+};
+
+// 依赖图上的关键路径排期：最早时间从依赖向下游正向传播，最晚完成时间从截止日期向上游反向传播
+// 记录没有工期字段，剩余工期按标称工期乘以未完成比例估算，已完成的任务为 0
+// 修改只标记直接受影响的任务，查询前按依赖图的拓扑序号向下游（最早时间）和上游（最晚时间）传播，
+// 结果不变的任务不再继续传播，开销只与真正改变的任务数有关
+class TaskSchedule
+{
+public:
+    static const qint64 NOMINAL_DURATION_SECS = 2 * 24 * 3600;
+
+    explicit TaskSchedule(const DependencyGraph *graph);
+
+    static qint64 remainingFor(const TaskRecord &record);
+    static qint64 deadlineFor(const TaskRecord &record);
+
+    // 最早开始时间的下限（通常是当前时间），修改后整体重算
+    void setReferenceTime(qint64 secs);
+    // 设置任务的剩余工期和截止日期，只有值变化时才标记重算
+    void setTask(TaskId id, qint64 remaining, qint64 deadline);
+    // 必须在从依赖图中删除节点之前调用，相邻的任务标记为重算
+    void removeTask(TaskId id);
+    // id 与 dependencyId 之间的依赖边增加或删除后调用
+    void edgeChanged(TaskId id, TaskId dependencyId);
+    void invalidateAll();
+    void clear();
+
+    // 重算标记过的任务及结果随之改变的上下游，没有待重算时立即返回
+    void update() const;
+    // 上一次 update 重算的任务数
+    int lastUpdateCount() const { return m_lastUpdateCount; }
+
+    // 未调用 update 时可能是旧值；任务不存在时返回 nullptr
+    const TaskTiming *timing(TaskId id) const;
+    // 决定 id 最早开始时间的依赖链，从起点到 id
+    QVector<TaskId> criticalPath(TaskId id) const;
+
+private:
+    void rebuild() const;
+    void propagateForward() const;
+    void propagateBackward() const;
+    // 返回结果是否改变
+    bool computeEarliest(int node) const;
+    bool computeLatest(int node) const;
+
+    const DependencyGraph *m_graph;
+    qint64 m_referenceTime;
+    mutable QHash<TaskId, TaskTiming> m_timings;
+    mutable QSet<TaskId> m_dirtyForward;        // 最早时间需要从这些任务向下游重算
+    mutable QSet<TaskId> m_dirtyBackward;       // 最晚完成时间需要从这些任务向上游重算
+    mutable bool m_rebuild;
+    mutable int m_lastUpdateCount;
+};
+
+#endif // TASKSCHEDULE_H